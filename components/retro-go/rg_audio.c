@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #if !defined(ESP_PLATFORM) && (RG_AUDIO_USE_INT_DAC || RG_AUDIO_USE_EXT_DAC)
 #error "I2S support can only be build inside esp-idf!"
@@ -34,6 +35,7 @@ static const rg_audio_sink_t sinks[] = {
 #if RG_AUDIO_USE_SDL2
     {RG_AUDIO_SINK_SDL2,    0, "SDL2"   },
 #endif
+    {RG_AUDIO_SINK_FILE,    0, "WAV file"},
   // {RG_AUDIO_SINK_BT_A2DP, 0, "Bluetooth"},
 };
 
@@ -46,9 +48,77 @@ static const rg_audio_sink_t sinks[] = {
     })
 #define RELEASE_DEVICE() rg_queue_send(audioDevLock, NULL, 0)
 
+// The ring is written by rg_audio_submit() (the emulator) and read by the sink task, nothing else.
+// Its length must be a power of two. The resampler tries to keep it half full (~32ms at 32KHz).
+#define RING_LENGTH (2048)
+#define RING_MASK   (RING_LENGTH - 1)
+#define RING_TARGET (RING_LENGTH / 2)
+// Frames sent to the sink at once, it matches the I2S DMA buffer length
+#define CHUNK_LENGTH (180)
+// Input frames read at once, enough for a full chunk at the maximum speed (2.5x + DRC)
+#define INPUT_LENGTH (CHUNK_LENGTH * 3)
+// Resampler step is Q16.16 (input frames per output frame)
+#define RESAMPLE_ONE (1 << 16)
+// Dynamic rate control: the step is nudged by up to +/-0.5% depending on how far the fill is from the target
+#define DRC_MAX_PPM (5000)
+
 static rg_audio_t audio;
 static rg_queue_t *audioDevLock;
 static rg_audio_counters_t counters;
+static rg_audio_pacing_t pacing = RG_AUDIO_PACING_BLOCK;
+
+static void audio_task(void *arg);
+static void dsp_reset(void);
+
+static struct
+{
+    rg_audio_frame_t *buffer;
+    uint32_t head; // Written by the producer only
+    uint32_t tail; // Written by the consumer only
+    rg_queue_t *data_ready;
+    rg_queue_t *space_ready;
+} ring;
+
+static struct
+{
+    uint32_t speed; // Base step, Q16.16, it's the emulation speed (fast forward)
+    uint32_t step;  // Current step, speed adjusted by DRC
+    uint32_t frac;  // Position between s0 and s1, Q16
+    rg_audio_frame_t s0, s1;
+} resampler = {RESAMPLE_ONE, RESAMPLE_ONE, 0};
+
+// Pseudo-stereo delay, ~8ms at 32KHz. Must be a power of two.
+#define STEREO_DELAY (256)
+
+static struct
+{
+    int32_t lowpass_alpha; // Q15, derived from the sample rate
+    int32_t lowpass[2];    // Q8
+    int32_t dc_prev[2];
+    int32_t dc_out[2];     // Q8
+    int16_t delay[STEREO_DELAY];
+    uint32_t delay_pos;
+} dsp;
+
+// Capture ring, it's drained to the file by its own task. Must be a power of two. ~250ms at 32KHz.
+#define CAPTURE_LENGTH (8192)
+#define CAPTURE_MASK   (CAPTURE_LENGTH - 1)
+#define CAPTURE_PATH   RG_STORAGE_ROOT "/audio.wav"
+
+static struct
+{
+    FILE *fp;
+    rg_audio_frame_t *buffer;
+    uint32_t head; // Written by rg_audio_submit only
+    uint32_t tail; // Written by the writer task only
+    rg_queue_t *data_ready;
+    rg_queue_t *space_ready;
+    rg_queue_t *done;
+    uint32_t frames;
+    int sampleRate;
+    bool lossless;
+    volatile bool running;
+} capture;
 
 static const char *SETTING_OUTPUT = "AudioSink";
 static const char *SETTING_VOLUME = "Volume";
@@ -63,11 +133,27 @@ void rg_audio_init(int sampleRate)
     {
         audioDevLock = rg_queue_create(1, 0);
         RELEASE_DEVICE();
+        ring.buffer = rg_alloc(RING_LENGTH * sizeof(rg_audio_frame_t), MEM_FAST);
+        ring.data_ready = rg_queue_create(1, 0);
+        ring.space_ready = rg_queue_create(1, 0);
+        rg_task_create("rg_audio", &audio_task, NULL, 3 * 1024, RG_TASK_PRIORITY_7, 1);
     }
 
     ACQUIRE_DEVICE(1000);
 
     int sinkType = (int)rg_settings_get_number(NS_GLOBAL, SETTING_OUTPUT, sinks[0].type);
+    if (rg_bench_get_config()->headless)
+    {
+        // Nothing is listening, the dummy sink drains the ring as fast as the emulator fills it
+        sinkType = RG_AUDIO_SINK_DUMMY;
+        pacing = RG_AUDIO_PACING_DROP;
+        // Unless we're rendering to a file, then nothing can be dropped (but it's still faster than real time)
+        if (rg_bench_get_config()->audio)
+        {
+            sinkType = RG_AUDIO_SINK_FILE;
+            pacing = RG_AUDIO_PACING_BLOCK;
+        }
+    }
     for (size_t i = 0; i < RG_COUNT(sinks); ++i)
     {
         if (!audio.sink || sinks[i].type == sinkType)
@@ -76,6 +162,7 @@ void rg_audio_init(int sampleRate)
     audio.filter = (int)rg_settings_get_number(NS_GLOBAL, SETTING_FILTER, 0);
     audio.volume = (int)rg_settings_get_number(NS_GLOBAL, SETTING_VOLUME, 50);
     audio.sampleRate = sampleRate;
+    dsp_reset();
 
     const char *error_string = NULL;
 
@@ -83,6 +170,12 @@ void rg_audio_init(int sampleRate)
     {
         error_string = NULL;
     }
+    else if (audio.sink->type == RG_AUDIO_SINK_FILE)
+    {
+        const char *path = rg_bench_get_config()->audio ?: CAPTURE_PATH;
+        if (!rg_audio_capture_start(path))
+            error_string = "Failed to start the capture!";
+    }
     else if (audio.sink->type == RG_AUDIO_SINK_I2S_DAC)
     {
     #if RG_AUDIO_USE_INT_DAC
@@ -182,6 +275,10 @@ void rg_audio_deinit(void)
     {
         // Nothing to do!
     }
+    else if (audio.sink->type == RG_AUDIO_SINK_FILE)
+    {
+        rg_audio_capture_stop();
+    }
     else if (audio.sink->type == RG_AUDIO_SINK_I2S_DAC)
     {
     #if RG_AUDIO_USE_INT_DAC
@@ -221,96 +318,492 @@ void rg_audio_deinit(void)
     RELEASE_DEVICE();
 }
 
-void rg_audio_submit(const rg_audio_frame_t *frames, size_t count)
+static inline size_t ring_count(void)
 {
-    const int64_t time_start = rg_system_timer();
+    return __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE);
+}
 
-    if (!audio.sink)
-        return;
+static void dsp_reset(void)
+{
+    memset(&dsp, 0, sizeof(dsp));
+    // One-pole low-pass at ~7KHz, it takes the edge off square waves without muffling
+    float rate = RG_MAX(audio.sampleRate, 8000);
+    dsp.lowpass_alpha = (1.f - expf(-2.f * (float)M_PI * 7000.f / rate)) * 0x8000;
+}
 
-    if (!frames || !count)
-        return;
+static inline int soft_clip(int sample)
+{
+    // Linear up to the knee, then it smoothly approaches full scale instead of clipping hard
+    const int knee = 0x6000, range = 0x7FFF - knee;
+    int excess = RG_MAX(abs(sample) - knee, 0);
+    int magnitude = knee + excess * range / (excess + range);
+    return sample < 0 ? -magnitude : magnitude;
+}
+
+// Applies the enabled filters (audio.filter) in a single pass, in place. The stages always run in
+// the same order: DC blocker, low-pass, pseudo-stereo, then soft or hard clipping.
+static void dsp_process(rg_audio_frame_t *frames, size_t count)
+{
+    const int filter = audio.filter;
 
-    if (!ACQUIRE_DEVICE(0))
+    if (!filter)
         return;
 
-    if (audio.sink->type == RG_AUDIO_SINK_DUMMY)
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t sample[2] = {frames[i].left, frames[i].right};
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            if (filter & RG_AUDIO_FILTER_DCBLOCK)
+            {
+                // y[n] = x[n] - x[n-1] + 0.996 * y[n-1]
+                int32_t out = (sample[ch] - dsp.dc_prev[ch]) * 256 + dsp.dc_out[ch] - (dsp.dc_out[ch] >> 8);
+                dsp.dc_prev[ch] = sample[ch];
+                dsp.dc_out[ch] = out;
+                sample[ch] = out >> 8;
+            }
+            if (filter & RG_AUDIO_FILTER_LOWPASS)
+            {
+                // y[n] = y[n-1] + alpha * (x[n] - y[n-1])
+                dsp.lowpass[ch] += ((int64_t)(sample[ch] * 256 - dsp.lowpass[ch]) * dsp.lowpass_alpha) >> 15;
+                sample[ch] = dsp.lowpass[ch] >> 8;
+            }
+        }
+
+        if (filter & RG_AUDIO_FILTER_STEREO)
+        {
+            // Complementary comb filters on the mid signal, mono sources get some width
+            int32_t mid = (sample[0] + sample[1]) >> 1;
+            int32_t delayed = dsp.delay[dsp.delay_pos] * 9830 >> 15; // 0.3
+            dsp.delay[dsp.delay_pos] = mid;
+            dsp.delay_pos = (dsp.delay_pos + 1) & (STEREO_DELAY - 1);
+            sample[0] += delayed;
+            sample[1] -= delayed;
+        }
+
+        if (filter & RG_AUDIO_FILTER_SOFTCLIP)
+        {
+            sample[0] = soft_clip(sample[0]);
+            sample[1] = soft_clip(sample[1]);
+        }
+
+        frames[i].left = RG_MIN(RG_MAX(sample[0], -0x8000), 0x7FFF);
+        frames[i].right = RG_MIN(RG_MAX(sample[1], -0x8000), 0x7FFF);
+    }
+}
+
+// The volume used to be applied as `(int)(sample * (volume * 0.01f))`. To stay bit-exact without the FPU the
+// gain is that float in Q31 (exact, its 24 bits mantissa fits for every volume) and scale_sample() reproduces
+// the rounding of the float product to 24 significant bits before truncating it.
+static inline uint32_t make_gain(int volume)
+{
+    return (uint32_t)ldexpf(volume * 0.01f, 31);
+}
+
+static inline int scale_sample(int sample, uint32_t gain)
+{
+    uint32_t magnitude = sample < 0 ? -sample : sample;
+    uint64_t product = (uint64_t)magnitude * gain; // Q31, exact
+    uint32_t result = product >> 31;
+    // The float product rounded up to the next integer when it was within half an ulp of it (ties too), that
+    // is 2^(log2(product) - 24). It's below 2^22 in Q31 for 16 bits samples so this is rarely needed.
+    if (__builtin_expect(((uint32_t)product & 0x7FFFFFFF) >= 0x7FC00000, 0))
+        result = (product + ((uint64_t)64 << (31 - __builtin_clz((uint32_t)(product >> 30) | 1)))) >> 31;
+    return sample < 0 ? -(int)result : (int)result;
+}
+
+static inline void convert_frame(rg_audio_frame_t *frame, uint32_t gain, bool differential)
+{
+    int left = scale_sample(frame->left, gain);
+    int right = scale_sample(frame->right, gain);
+
+    // Differential mono: the signal goes on the right channel and what exceeds +/-0x7F00 spills
+    // on the left one. Clipping isn't necessary, gain is never above 1.0.
+    if (differential)
+    {
+        int sample = (left + right) >> 1;
+        int clamped = RG_MIN(RG_MAX(sample, -0x7F00), 0x7F00);
+        left = 0x8000 + (sample - clamped);
+        right = -0x8000 + clamped;
+    }
+
+    frame->left = left;
+    frame->right = right;
+}
+
+// differential is expected to be a constant so that each variant gets its own unrolled loop.
+static inline __attribute__((always_inline)) void convert_frames(rg_audio_frame_t *frames, size_t count,
+                                                                 uint32_t gain, bool differential)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        convert_frame(&frames[i + 0], gain, differential);
+        convert_frame(&frames[i + 1], gain, differential);
+        convert_frame(&frames[i + 2], gain, differential);
+        convert_frame(&frames[i + 3], gain, differential);
+    }
+    for (; i < count; ++i)
+        convert_frame(&frames[i], gain, differential);
+}
+
+void rg_audio_convert(rg_audio_frame_t *frames, size_t count, int volume, bool differential)
+{
+    uint32_t gain = make_gain(RG_MIN(RG_MAX(volume, 0), 100));
+    if (differential)
+        convert_frames(frames, count, gain, true);
+    else
+        convert_frames(frames, count, gain, false);
+}
+
+// frames is converted in place for the I2S sinks
+static void sink_write(rg_audio_frame_t *frames, size_t count)
+{
+    if (audio.sink->type == RG_AUDIO_SINK_DUMMY || audio.sink->type == RG_AUDIO_SINK_FILE)
     {
-        rg_usleep((uint32_t)(count * (1000000.f / audio.sampleRate)));
+        // In headless mode nothing paces the emulation, it runs as fast as it can
+        if (!rg_bench_get_config()->headless)
+            rg_usleep((uint32_t)(count * (1000000.f / audio.sampleRate)));
     }
     else if (audio.sink->type == RG_AUDIO_SINK_I2S_DAC || audio.sink->type == RG_AUDIO_SINK_I2S_EXT)
     {
     #if RG_AUDIO_USE_INT_DAC || RG_AUDIO_USE_EXT_DAC
-        float volume = audio.muted ? 0.f : (audio.volume * 0.01f);
-        rg_audio_frame_t buffer[180];
         size_t written = 0;
-        size_t pos = 0;
 
         // In speaker mode we use left and right as a differential mono output to increase resolution.
-        bool differential = audio.sink->type == RG_AUDIO_SINK_I2S_DAC;
+        rg_audio_convert(frames, count, audio.muted ? 0 : audio.volume, audio.sink->type == RG_AUDIO_SINK_I2S_DAC);
 
-        for (size_t i = 0; i < count; ++i)
+        // This blocks until there's room in the DMA buffers, it's what paces the sink task
+        if (i2s_write(I2S_NUM_0, (void *)frames, count * 4, &written, 1000) != ESP_OK)
+            RG_LOGW("I2S Submission error! Written: %d/%d\n", written, count * 4);
+    #endif
+    }
+    else if (audio.sink->type == RG_AUDIO_SINK_SDL2)
+    {
+    #if RG_AUDIO_USE_SDL2
+        // SDL_QueueAudio never blocks, we pace ourselves on the device's queue (~2 chunks)
+        SDL_QueueAudio(audioDevice, (void *)frames, count * 4);
+        SDL_PauseAudioDevice(audioDevice, 0);
+        while (SDL_GetQueuedAudioSize(audioDevice) > CHUNK_LENGTH * 4 * 2)
+            rg_task_delay(1);
+    #endif
+    }
+}
+
+// Linear interpolation resampler. It stops when either the input or the output is exhausted, the
+// position carries over to the next call. Returns the number of frames written to output.
+static size_t resample(const rg_audio_frame_t *input, size_t *input_count, rg_audio_frame_t *output, size_t output_count)
+{
+    const uint32_t step = resampler.step;
+    uint32_t frac = resampler.frac;
+    rg_audio_frame_t s0 = resampler.s0, s1 = resampler.s1;
+    size_t consumed = 0, produced = 0;
+
+    while (produced < output_count)
+    {
+        while (frac >= RESAMPLE_ONE && consumed < *input_count)
         {
-            int left = frames[i].left * volume;
-            int right = frames[i].right * volume;
+            s0 = s1;
+            s1 = input[consumed++];
+            frac -= RESAMPLE_ONE;
+        }
+        if (frac >= RESAMPLE_ONE)
+            break;
+        // Q15 weight so that the product fits in 32 bits
+        int32_t weight = frac >> 1;
+        output[produced].left = s0.left + (((s1.left - s0.left) * weight) >> 15);
+        output[produced].right = s0.right + (((s1.right - s0.right) * weight) >> 15);
+        frac += step;
+        produced++;
+    }
+
+    resampler.frac = frac;
+    resampler.s0 = s0;
+    resampler.s1 = s1;
+    *input_count = consumed;
+    return produced;
+}
+
+static void audio_task(void *arg)
+{
+    static rg_audio_frame_t input[INPUT_LENGTH];
+    // The resampler writes here, it's then converted in place and handed to the driver as is
+    rg_audio_frame_t *chunk = rg_alloc(CHUNK_LENGTH * sizeof(rg_audio_frame_t), MEM_DMA);
+    bool playing = false;
+
+    while (1)
+    {
+        size_t available = ring_count();
+
+        counters.bufferFill = available;
+
+        if (available == 0)
+        {
+            // The sink ran dry while playing. On I2S the DMA will repeat/zero its buffers, we just keep count.
+            if (playing)
+                counters.underruns++;
+            playing = false;
+            rg_queue_receive(ring.data_ready, NULL, 100);
+            continue;
+        }
+
+        // Consume slightly faster when the ring is fuller than the target, slower when it's emptier. Over
+        // time it absorbs the drift between the emulation and the device clock without pops or stalls.
+        int32_t error = RG_MIN(RG_MAX((int32_t)available - RING_TARGET, -RING_TARGET), RING_TARGET);
+        int32_t ppm = error * DRC_MAX_PPM / RING_TARGET;
+        resampler.step = resampler.speed + (int32_t)((int64_t)resampler.speed * ppm / 1000000);
+        counters.drcAdjust = ppm;
+
+        size_t needed = (((uint64_t)CHUNK_LENGTH * resampler.step + resampler.frac) >> 16) + 1;
+        size_t count = RG_MIN(RG_MIN(available, needed), INPUT_LENGTH);
+        uint32_t tail = ring.tail;
+        for (size_t i = 0; i < count; ++i)
+            input[i] = ring.buffer[(tail + i) & RING_MASK];
 
-            if (differential)
+        const int64_t resample_start = rg_system_timer();
+        size_t produced = resample(input, &count, chunk, CHUNK_LENGTH);
+        counters.resampleTime += rg_system_timer() - resample_start;
+        counters.resampleFrames += produced;
+
+        __atomic_store_n(&ring.tail, tail + count, __ATOMIC_RELEASE);
+        rg_queue_send(ring.space_ready, NULL, 0);
+        playing = true;
+
+        if (produced == 0)
+            continue;
+
+        count = produced;
+
+        const int64_t time_start = rg_system_timer();
+        if (ACQUIRE_DEVICE(100))
+        {
+            if (audio.sink)
             {
-                int sample = (left + right) >> 1;
-                if (sample > 0x7F00)
-                {
-                    left = 0x8000 + (sample - 0x7F00);
-                    right = -0x8000 + 0x7F00;
-                }
-                else if (sample < -0x7F00)
-                {
-                    left = 0x8000 + (sample + 0x7F00);
-                    right = -0x8000 + -0x7F00;
-                }
-                else
-                {
-                    left = 0x8000;
-                    right = -0x8000 + sample;
-                }
+                dsp_process(chunk, count);
+                sink_write(chunk, count);
             }
+            RELEASE_DEVICE();
+        }
+        counters.sinkTime += rg_system_timer() - time_start;
+    }
+}
+
+static void write_wav_header(FILE *fp, int sampleRate, uint32_t frames)
+{
+    uint32_t data_size = frames * 4;
+    uint32_t header[11] = {
+        0x46464952, 36 + data_size, 0x45564157, // "RIFF" size "WAVE"
+        0x20746D66, 16, (2 << 16) | 1,          // "fmt " size, PCM, 2 channels
+        sampleRate, sampleRate * 4,             // sample rate, byte rate
+        (16 << 16) | 4,                         // block align, bits per sample
+        0x61746164, data_size,                  // "data" size
+    };
+    fseek(fp, 0, SEEK_SET);
+    fwrite(header, sizeof(header), 1, fp);
+}
+
+static void capture_task(void *arg)
+{
+    while (1)
+    {
+        uint32_t tail = capture.tail;
+        size_t available = __atomic_load_n(&capture.head, __ATOMIC_ACQUIRE) - tail;
 
-            // Clipping   (not necessary, we have (int16 * vol) and volume is never more than 1.0)
-            // if (left > 32767) left = 32767; else if (left < -32768) left = -32767;
-            // if (right > 32767) right = 32767; else if (right < -32768) right = -32767;
+        if (available == 0)
+        {
+            if (!capture.running)
+                break;
+            rg_queue_receive(capture.data_ready, NULL, 100);
+            continue;
+        }
 
-            // Queue
-            buffer[pos].left = left;
-            buffer[pos].right = right;
+        // Write up to the end of the buffer, the rest will be done in the next pass
+        size_t count = RG_MIN(available, CAPTURE_LENGTH - (tail & CAPTURE_MASK));
+        if (fwrite(&capture.buffer[tail & CAPTURE_MASK], 4, count, capture.fp) != count)
+            RG_LOGE("Capture write failed!\n");
+        capture.frames += count;
 
-            if (i == count - 1 || ++pos == RG_COUNT(buffer))
+        __atomic_store_n(&capture.tail, tail + count, __ATOMIC_RELEASE);
+        rg_queue_send(capture.space_ready, NULL, 0);
+    }
+
+    write_wav_header(capture.fp, capture.sampleRate, capture.frames);
+    fclose(capture.fp);
+    capture.fp = NULL;
+    RG_LOGI("Capture done: %d frames.\n", (int)capture.frames);
+    rg_queue_send(capture.done, NULL, 0);
+}
+
+static void capture_write(const rg_audio_frame_t *frames, size_t count)
+{
+    while (count > 0)
+    {
+        uint32_t head = capture.head;
+        size_t space = CAPTURE_LENGTH - (head - __atomic_load_n(&capture.tail, __ATOMIC_ACQUIRE));
+        size_t n = RG_MIN(space, count);
+
+        if (n == 0)
+        {
+            // When a device is playing we can't wait for the storage
+            if (!capture.lossless)
             {
-                if (i2s_write(I2S_NUM_0, (void *)buffer, pos * 4, &written, 1000) != ESP_OK)
-                    RG_LOGW("I2S Submission error! Written: %d/%d\n", written, pos * 4);
-                pos = 0;
+                counters.captureDropped += count;
+                break;
             }
+            rg_queue_receive(capture.space_ready, NULL, 100);
+            continue;
         }
-    #endif
+
+        for (size_t i = 0; i < n; ++i)
+            capture.buffer[(head + i) & CAPTURE_MASK] = frames[i];
+        __atomic_store_n(&capture.head, head + n, __ATOMIC_RELEASE);
+        rg_queue_send(capture.data_ready, NULL, 0);
+
+        frames += n;
+        count -= n;
     }
-    else if (audio.sink->type == RG_AUDIO_SINK_SDL2)
+}
+
+bool rg_audio_capture_start(const char *filename)
+{
+    RG_ASSERT(filename, "bad param");
+
+    if (capture.running)
+        rg_audio_capture_stop();
+
+    if (!capture.buffer)
     {
-    #if RG_AUDIO_USE_SDL2
-        SDL_QueueAudio(audioDevice, (void *)frames, count * 4);
-        SDL_PauseAudioDevice(audioDevice, 0);
-        // This is ugly, but we must emulate how it works on the ESP32, where the audio does the pacing!
-        static int64_t frame_start = 0;
-        int64_t frame_end = frame_start + (uint32_t)(count * (1000000.f / audio.sampleRate)) - 500;
-        if (frame_end > rg_system_timer())
-            rg_usleep((frame_end - rg_system_timer()));
-        frame_start = rg_system_timer();
-    #endif
+        capture.buffer = rg_alloc(CAPTURE_LENGTH * sizeof(rg_audio_frame_t), MEM_SLOW);
+        capture.data_ready = rg_queue_create(1, 0);
+        capture.space_ready = rg_queue_create(1, 0);
+        capture.done = rg_queue_create(1, 0);
     }
 
-    RELEASE_DEVICE();
+    if (!(capture.fp = fopen(filename, "wb")))
+    {
+        RG_LOGE("Failed to open '%s'\n", filename);
+        return false;
+    }
+
+    // The header is rewritten with the final size when the capture stops
+    write_wav_header(capture.fp, audio.sampleRate, 0);
+    capture.head = capture.tail = 0;
+    capture.frames = 0;
+    capture.sampleRate = audio.sampleRate;
+    capture.lossless = !audio.sink || audio.sink->type == RG_AUDIO_SINK_DUMMY ||
+                       audio.sink->type == RG_AUDIO_SINK_FILE;
+    capture.running = true;
+
+    // The writer is created on demand and there are only so many task slots, if none is free the capture fails
+    if (!rg_task_try_create("rg_capture", &capture_task, NULL, 3 * 1024, RG_TASK_PRIORITY_2, -1))
+    {
+        RG_LOGE("Failed to start the capture task!\n");
+        capture.running = false;
+        fclose(capture.fp);
+        capture.fp = NULL;
+        remove(filename);
+        return false;
+    }
+
+    RG_LOGI("Capturing audio to '%s' (%dHz)\n", filename, capture.sampleRate);
+    return true;
+}
+
+void rg_audio_capture_stop(void)
+{
+    if (!capture.running)
+        return;
+
+    capture.running = false;
+    rg_queue_send(capture.data_ready, NULL, 0);
+    if (!rg_queue_receive(capture.done, NULL, 5000))
+        RG_LOGE("Capture task didn't finish!\n");
+}
+
+bool rg_audio_capture_active(void)
+{
+    return capture.running;
+}
+
+void rg_audio_submit(const rg_audio_frame_t *frames, size_t count)
+{
+    const int64_t time_start = rg_system_timer();
+
+    if (!audio.sink)
+        return;
+
+    if (!frames || !count)
+        return;
+
+    rg_bench_hash_audio(frames, count * 4);
+
+    if (capture.running)
+        capture_write(frames, count);
 
     counters.totalSamples += count;
+
+    // Wait until the ring will be half full once we've written, on average. Blocking only when the
+    // ring is full would keep it full and the DRC would be stuck at its maximum.
+    if (pacing == RG_AUDIO_PACING_BLOCK)
+    {
+        size_t threshold = RING_TARGET - RG_MIN(count / 2, RING_TARGET / 2);
+        while (ring_count() > threshold)
+            rg_queue_receive(ring.space_ready, NULL, 100);
+    }
+
+    while (count > 0)
+    {
+        uint32_t head = ring.head;
+        size_t space = RING_LENGTH - ring_count();
+        size_t n = RG_MIN(space, count);
+
+        if (n == 0)
+        {
+            if (pacing == RG_AUDIO_PACING_DROP)
+            {
+                counters.overruns += count;
+                break;
+            }
+            // The sink is behind, this is where the emulation gets paced by the audio
+            rg_queue_receive(ring.space_ready, NULL, 100);
+            continue;
+        }
+
+        for (size_t i = 0; i < n; ++i)
+            ring.buffer[(head + i) & RING_MASK] = frames[i];
+        __atomic_store_n(&ring.head, head + n, __ATOMIC_RELEASE);
+        rg_queue_send(ring.data_ready, NULL, 0);
+
+        frames += n;
+        count -= n;
+    }
+
     counters.busyTime += rg_system_timer() - time_start;
 }
 
+void rg_audio_set_pacing(rg_audio_pacing_t policy)
+{
+    pacing = policy;
+}
+
+rg_audio_pacing_t rg_audio_get_pacing(void)
+{
+    return pacing;
+}
+
+void rg_audio_set_speed(float speed)
+{
+    // The device keeps running at the same rate, we just consume the input faster or slower
+    resampler.speed = RG_MIN(RG_MAX(speed, 0.25f), 2.75f) * RESAMPLE_ONE;
+    RG_LOGI("Resampling ratio set to %.3f\n", speed);
+}
+
+float rg_audio_get_speed(void)
+{
+    return (float)resampler.speed / RESAMPLE_ONE;
+}
+
 const rg_audio_t *rg_audio_get_info(void)
 {
     return &audio;
@@ -340,6 +833,23 @@ void rg_audio_set_sink(rg_sink_type_t sink)
     rg_audio_init(audio.sampleRate);
 }
 
+int rg_audio_get_filter(void)
+{
+    return audio.filter;
+}
+
+void rg_audio_set_filter(int filter)
+{
+    if (ACQUIRE_DEVICE(1000))
+    {
+        audio.filter = filter;
+        dsp_reset();
+        RELEASE_DEVICE();
+    }
+    rg_settings_set_number(NS_GLOBAL, SETTING_FILTER, filter);
+    RG_LOGI("Audio filter set to 0x%02X\n", filter);
+}
+
 int rg_audio_get_volume(void)
 {
     return audio.volume;
@@ -404,6 +914,7 @@ void rg_audio_set_sample_rate(int sampleRate)
             RG_LOGI("i2s_set_sample_rates(%d)\n", sampleRate);
             i2s_set_sample_rates(I2S_NUM_0, sampleRate);
             audio.sampleRate = sampleRate;
+            dsp_reset();
             RELEASE_DEVICE();
         }
     #endif
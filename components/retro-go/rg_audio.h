@@ -10,6 +10,7 @@ typedef enum
     RG_AUDIO_SINK_BT_A2DP,
     RG_AUDIO_SINK_SDL2,
     RG_AUDIO_SINK_DUMMY,
+    RG_AUDIO_SINK_FILE, // Dummy sink that records to a WAV file
 } rg_sink_type_t;
 
 typedef struct
@@ -32,10 +33,33 @@ typedef struct // __attribute__((packed))
 
 typedef rg_audio_frame_t rg_audio_sample_t;
 
+// Post-processing stages applied by the sink, rg_audio_t.filter is a combination of these
+typedef enum
+{
+    RG_AUDIO_FILTER_LOWPASS = (1 << 0),  // One-pole low-pass, ~7KHz
+    RG_AUDIO_FILTER_DCBLOCK = (1 << 1),  // Removes DC offset (some cores' output isn't centered)
+    RG_AUDIO_FILTER_SOFTCLIP = (1 << 2), // Compresses peaks instead of clipping them
+    RG_AUDIO_FILTER_STEREO = (1 << 3),   // Pseudo-stereo for mono sources
+} rg_audio_filter_t;
+
+typedef enum
+{
+    RG_AUDIO_PACING_BLOCK = 0, // rg_audio_submit() waits for room in the ring buffer, the sink paces the emulation
+    RG_AUDIO_PACING_DROP,      // rg_audio_submit() never waits, frames that don't fit are dropped
+} rg_audio_pacing_t;
+
 typedef struct
 {
     int64_t totalSamples;
-    int64_t busyTime;
+    int64_t busyTime;   // Time spent in rg_audio_submit (including waiting for room)
+    int64_t sinkTime;   // Time spent by the sink task writing to the device
+    int64_t underruns;  // Times the sink ran out of frames
+    int64_t overruns;   // Frames dropped because the ring buffer was full
+    int32_t bufferFill; // Frames waiting in the ring buffer
+    int32_t drcAdjust;  // Current resampling ratio adjustment, in ppm
+    int64_t resampleTime;
+    int64_t resampleFrames;
+    int64_t captureDropped; // Frames that couldn't be recorded because the storage was too slow
 } rg_audio_counters_t;
 
 typedef struct
@@ -52,11 +76,28 @@ void rg_audio_deinit(void);
 void rg_audio_submit(const rg_audio_frame_t *frames, size_t count);
 const rg_audio_t *rg_audio_get_info(void);
 rg_audio_counters_t rg_audio_get_counters(void);
+void rg_audio_set_pacing(rg_audio_pacing_t policy);
+rg_audio_pacing_t rg_audio_get_pacing(void);
+void rg_audio_set_speed(float speed);
+
+// Applies the volume (0-100) and the DAC encoding (differential mono or plain stereo) in place, as done
+// for the I2S sinks. Bit-exact with the float code it replaced, which rg_bench checks (RG_BENCH_DAC).
+void rg_audio_convert(rg_audio_frame_t *frames, size_t count, int volume, bool differential);
+
+// Records everything submitted to a WAV file, alongside the current sink. The file is written by
+// a separate task. If a real device is playing, frames are dropped rather than waiting for the storage.
+bool rg_audio_capture_start(const char *filename);
+void rg_audio_capture_stop(void);
+bool rg_audio_capture_active(void);
+
+float rg_audio_get_speed(void);
 
 const rg_audio_sink_t *rg_audio_get_sinks(size_t *count);
 const rg_audio_sink_t *rg_audio_get_sink(void);
 void rg_audio_set_sink(rg_sink_type_t sink);
 
+int rg_audio_get_filter(void);
+void rg_audio_set_filter(int filter);
 int rg_audio_get_volume(void);
 void rg_audio_set_volume(int percent);
 bool rg_audio_get_mute(void);
@@ -0,0 +1,429 @@
+#include "rg_system.h"
+#include "rg_bench.h"
+#include "rg_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+typedef struct
+{
+    int frame;
+    uint32_t keys;
+} input_event_t;
+
+static rg_bench_config_t config;
+static struct
+{
+    input_event_t *events;
+    size_t count;
+    size_t pos;
+} script;
+static struct
+{
+    FILE *fp;
+    bool recording;
+    int compared;
+    uint32_t video;
+    uint32_t audio;
+} hashes;
+static int ticks;
+static struct
+{
+    int32_t *frameTimes; // Wall time between two ticks, in us
+    int frames;
+    int64_t startTime;
+    int64_t lastTick;
+    int64_t busyTime;
+    rg_display_counters_t display;
+    rg_audio_counters_t audio;
+} bench;
+
+
+static bool load_input_script(const char *filename)
+{
+    const char *names[RG_KEY_COUNT] = {"UP", "RIGHT", "DOWN", "LEFT", "SELECT", "START", "MENU", "OPTION",
+                                       "A",  "B",     "X",    "Y",    "L",      "R"};
+    char line[256];
+    FILE *fp;
+
+    if (!(fp = fopen(filename, "r")))
+        return false;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        char *token = strtok(line, " \t\r\n");
+        if (!token || token[0] == '#')
+            continue;
+
+        input_event_t event = {atoi(token), 0};
+        while ((token = strtok(NULL, " \t\r\n")))
+        {
+            for (int key = 0; key < RG_KEY_COUNT; ++key)
+            {
+                if (strcasecmp(token, names[key]) == 0)
+                    event.keys |= (1 << key);
+            }
+        }
+
+        script.events = realloc(script.events, (script.count + 1) * sizeof(input_event_t));
+        RG_ASSERT(script.events, "Out of memory");
+        script.events[script.count++] = event;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+// The I2S conversion as it was before rg_audio_convert(), the reference for bench_dac()
+static void convert_float(rg_audio_frame_t *frames, size_t count, int volume, bool differential)
+{
+    float vol = volume * 0.01f;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        int left = frames[i].left * vol;
+        int right = frames[i].right * vol;
+
+        if (differential)
+        {
+            int sample = (left + right) >> 1;
+            if (sample > 0x7F00)
+            {
+                left = 0x8000 + (sample - 0x7F00);
+                right = -0x8000 + 0x7F00;
+            }
+            else if (sample < -0x7F00)
+            {
+                left = 0x8000 + (sample + 0x7F00);
+                right = -0x8000 + -0x7F00;
+            }
+            else
+            {
+                left = 0x8000;
+                right = -0x8000 + sample;
+            }
+        }
+
+        frames[i].left = left;
+        frames[i].right = right;
+    }
+}
+
+static void bench_dac(int passes)
+{
+    const size_t count = 0x10000;
+    rg_audio_frame_t *source = malloc(count * sizeof(rg_audio_frame_t));
+    rg_audio_frame_t *expected = malloc(count * sizeof(rg_audio_frame_t));
+    rg_audio_frame_t *actual = malloc(count * sizeof(rg_audio_frame_t));
+    RG_ASSERT(source && expected && actual, "Out of memory");
+
+    // Every value on both channels, paired differently so that the differential sums vary too
+    for (size_t i = 0; i < count; ++i)
+        source[i] = (rg_audio_frame_t){(int16_t)(i - 0x8000), (int16_t)(i * 40503)};
+
+    for (int differential = 0; differential < 2; ++differential)
+    {
+        for (int volume = 0; volume <= 100; ++volume)
+        {
+            memcpy(expected, source, count * sizeof(rg_audio_frame_t));
+            memcpy(actual, source, count * sizeof(rg_audio_frame_t));
+            convert_float(expected, count, volume, differential);
+            rg_audio_convert(actual, count, volume, differential);
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (memcmp(&expected[i], &actual[i], sizeof(rg_audio_frame_t)) != 0)
+                {
+                    printf("RG_BENCH dac mismatch! volume=%d differential=%d in=%d,%d expected=%d,%d got=%d,%d\n",
+                           volume, differential, source[i].left, source[i].right, expected[i].left,
+                           expected[i].right, actual[i].left, actual[i].right);
+                    exit(1);
+                }
+            }
+        }
+
+        int64_t floatTime = 0, fixedTime = 0;
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            memcpy(expected, source, count * sizeof(rg_audio_frame_t));
+            memcpy(actual, source, count * sizeof(rg_audio_frame_t));
+            int64_t start = rg_system_timer();
+            convert_float(expected, count, 75, differential);
+            int64_t middle = rg_system_timer();
+            rg_audio_convert(actual, count, 75, differential);
+            fixedTime += rg_system_timer() - middle;
+            floatTime += middle - start;
+        }
+        printf("RG_BENCH dac differential=%d bit-exact float=%.1fframes/us fixed=%.1fframes/us\n", differential,
+               (float)count * passes / RG_MAX(floatTime, 1), (float)count * passes / RG_MAX(fixedTime, 1));
+    }
+
+    free(source);
+    free(expected);
+    free(actual);
+    exit(0);
+}
+
+const rg_bench_config_t *rg_bench_init(void)
+{
+    const char *headless = getenv("RG_HEADLESS");
+    const char *frames = getenv("RG_BENCH_FRAMES");
+    const char *hash = getenv("RG_BENCH_HASH");
+    const char *save = getenv("RG_BENCH_SAVE");
+    const char *dac = getenv("RG_BENCH_DAC");
+    const char *lcd = getenv("RG_BENCH_LCD");
+    const char *osd = getenv("RG_BENCH_OSD");
+
+    config = (rg_bench_config_t){
+        .headless = headless && atoi(headless) != 0,
+        .frames = frames ? atoi(frames) : 0,
+        .core = getenv("RG_BENCH_CORE"),
+        .rom = getenv("RG_BENCH_ROM"),
+        .audio = getenv("RG_BENCH_AUDIO"),
+        .input = getenv("RG_BENCH_INPUT"),
+        .hashInterval = hash ? atoi(hash) : 0,
+        .golden = getenv("RG_BENCH_GOLDEN"),
+        .lcd = lcd && atoi(lcd) != 0,
+        .osdInterval = osd ? atoi(osd) : 0,
+        .saveInterval = save ? atoi(save) : 0,
+    };
+
+    if (dac && atoi(dac) > 0)
+        bench_dac(atoi(dac));
+
+    // A benchmark measures the emulator, not the host's window system or sound card
+    if (config.frames > 0)
+        config.headless = true;
+
+    if (config.input && !load_input_script(config.input))
+        RG_PANIC("Failed to load the input script!");
+
+    if (config.hashInterval > 0)
+    {
+        if (!config.golden)
+            hashes.fp = stdout;
+        else if ((hashes.fp = fopen(config.golden, "r")))
+            hashes.recording = false;
+        else if ((hashes.fp = fopen(config.golden, "w")))
+            hashes.recording = true;
+        else
+            RG_PANIC("Failed to open the golden file!");
+    }
+
+    if (config.headless)
+        RG_LOGW("Headless mode! frames:%d core:%s rom:%s", config.frames, config.core ?: "-", config.rom ?: "-");
+
+    return &config;
+}
+
+const rg_bench_config_t *rg_bench_get_config(void)
+{
+    return &config;
+}
+
+uint32_t rg_bench_read_input(void)
+{
+    // The script is indexed by ticks, which are frames for all cores
+    while (script.pos < script.count && script.events[script.pos].frame <= ticks)
+        script.pos++;
+    return script.pos > 0 ? script.events[script.pos - 1].keys : 0;
+}
+
+static uint32_t hash_surface(const rg_surface_t *surface)
+{
+    const void *data = surface->data + surface->offset;
+    const int line_size = surface->width * RG_PIXEL_GET_SIZE(surface->format);
+    uint32_t checksum = 0xFFFFFFFF;
+
+    for (int y = 0; y < surface->height; ++y)
+        checksum = (checksum * 31) ^ rg_hash(data + y * surface->stride, line_size);
+    if (surface->format & RG_PIXEL_PALETTE)
+        checksum = (checksum * 31) ^ rg_hash((void *)surface->palette, 256 * 2);
+
+    return checksum;
+}
+
+void rg_bench_hash_video(const rg_surface_t *update)
+{
+    // It's done on submit because the surface will be reused (and drawing may be skipped)
+    if (config.hashInterval > 0 && !config.lcd)
+        hashes.video = hash_surface(update);
+}
+
+void rg_bench_hash_audio(const void *frames, size_t size)
+{
+    if (config.hashInterval > 0)
+        hashes.audio = rg_crc32(hashes.audio, frames, size);
+}
+
+static void check_hashes(void)
+{
+    char expected[64], actual[64];
+
+    if (config.lcd)
+    {
+        // The display task must be done with the frames submitted so far (and the OSD changes)
+        rg_surface_t lcd;
+        rg_display_sync(true);
+        hashes.video = rg_display_get_lcd(&lcd) ? hash_surface(&lcd) : 0;
+    }
+
+    snprintf(actual, sizeof(actual), "%d %08X %08X\n", ticks, (unsigned)hashes.video, (unsigned)hashes.audio);
+    hashes.audio = 0;
+
+    if (hashes.fp == stdout || hashes.recording)
+    {
+        fputs(actual, hashes.fp);
+        return;
+    }
+
+    if (!fgets(expected, sizeof(expected), hashes.fp))
+    {
+        printf("RG_BENCH golden file ends at frame %d\n", ticks);
+        exit(1);
+    }
+
+    if (strcmp(expected, actual) != 0)
+    {
+        // Format is: frame video audio
+        expected[strcspn(expected, "\r\n")] = 0;
+        actual[strcspn(actual, "\r\n")] = 0;
+        printf("RG_BENCH mismatch! expected: %s got: %s\n", expected, actual);
+        exit(1);
+    }
+
+    hashes.compared++;
+}
+
+static void draw_osd_pattern(int step)
+{
+    const rg_display_t *display = rg_display_get_info();
+    uint16_t pattern[32][96];
+
+    if (step == 3)
+    {
+        rg_display_osd_clear();
+        return;
+    }
+
+    for (int y = 0; y < 32; ++y)
+    {
+        for (int x = 0; x < 96; ++x)
+        {
+            // Step 2 only changes the right half, the dirty area must not span the whole pattern
+            if (x >= 48 && step == 2)
+                pattern[y][x] = ((x ^ y) & 4) ? C_RED : C_TRANSPARENT;
+            else
+                pattern[y][x] = ((x ^ y) & 8) ? C_BLUE : C_TRANSPARENT;
+        }
+    }
+
+    // In the middle of the viewport, then once cleared in the top left corner (over the margins if there are any)
+    if (step == 4)
+        rg_display_osd_draw(8, 8, 96, 32, sizeof(pattern[0]), &pattern[0][0]);
+    else
+        rg_display_osd_draw((display->screen.width - 96) / 2, (display->screen.height - 32) / 2, 96, 32,
+                            sizeof(pattern[0]), &pattern[0][0]);
+}
+
+static int compare_int32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_report(void)
+{
+    const rg_app_t *app = rg_system_get_app();
+    rg_display_counters_t display = rg_display_get_counters();
+    rg_audio_counters_t audio = rg_audio_get_counters();
+    int frames = bench.frames;
+
+    float totalTime = RG_MAX(bench.lastTick - bench.startTime, 1);
+    float displayBlock = display.blockTime - bench.display.blockTime;
+    float displayBusy = display.busyTime - bench.display.busyTime;
+    float audioBusy = audio.busyTime - bench.audio.busyTime;
+    // Cores include the time spent in rg_display_submit in their busy time, it's not emulation
+    float emulationBusy = bench.busyTime - displayBlock;
+
+    qsort(bench.frameTimes, frames, sizeof(int32_t), compare_int32);
+
+    printf("RG_BENCH core=%s rom=%s frames=%d time=%.3fs fps=%.2f\n", app->configNs, app->romPath ?: "-", frames,
+           totalTime / 1000000.f, frames / (totalTime / 1000000.f));
+    printf("RG_BENCH frame_us p50=%d p90=%d p99=%d max=%d\n", (int)bench.frameTimes[frames * 50 / 100],
+           (int)bench.frameTimes[frames * 90 / 100], (int)bench.frameTimes[frames * 99 / 100],
+           (int)bench.frameTimes[frames - 1]);
+    printf("RG_BENCH busy emulation=%.1f%% display=%.1f%% audio=%.1f%% (display runs in its own task)\n",
+           emulationBusy / totalTime * 100.f, displayBusy / totalTime * 100.f, audioBusy / totalTime * 100.f);
+    printf("RG_BENCH display frames=%d full=%d partial=%d replaced=%d\n",
+           (int)(display.totalFrames - bench.display.totalFrames), (int)(display.fullFrames - bench.display.fullFrames),
+           (int)(display.partFrames - bench.display.partFrames),
+           (int)(display.framesReplaced - bench.display.framesReplaced));
+    float resampleTime = audio.resampleTime - bench.audio.resampleTime;
+    printf("RG_BENCH audio samples=%d dropped=%d resampler=%.1fsmp/us\n",
+           (int)(audio.totalSamples - bench.audio.totalSamples), (int)(audio.overruns - bench.audio.overruns),
+           resampleTime > 0 ? (audio.resampleFrames - bench.audio.resampleFrames) / resampleTime : 0.f);
+    rg_state_wait();
+    rg_state_counters_t state = rg_state_get_counters();
+    if (state.saves > 0)
+    {
+        printf("RG_BENCH savestate saves=%d full=%d avg=%dus max=%dus size=%dKB written=%dKB/save\n",
+               (int)state.saves, (int)state.fullSaves, (int)(state.saveTime / state.saves), (int)state.maxSaveTime,
+               (int)(state.stateBytes / state.saves / 1024), (int)(state.bytesWritten / state.saves / 1024));
+        printf("RG_BENCH savestate resume avg=%dus max=%dus\n", (int)(state.resumeTime / state.saves),
+               (int)state.maxResumeTime);
+    }
+    fflush(stdout);
+}
+
+void rg_bench_tick(int busyTime)
+{
+    ticks++;
+
+    if (config.hashInterval > 0 && ticks % config.hashInterval == 0)
+        check_hashes();
+
+    // After the hashes, so that the display task always gets frames to composite the change on before the next check
+    if (config.osdInterval > 0 && ticks % config.osdInterval == 0 && ticks / config.osdInterval <= 4)
+        draw_osd_pattern(ticks / config.osdInterval);
+
+    if (config.saveInterval > 0 && ticks % config.saveInterval == 0)
+    {
+        // Same path as a real save, minus the screenshot and the slot bookkeeping
+        if (!rg_storage_mkdir(RG_BASE_PATH_CACHE)
+            || !rg_state_save_async(RG_BASE_PATH_CACHE "/bench.sav", NULL, NULL, NULL, NULL))
+            RG_LOGE("Benchmark save failed!\n");
+    }
+
+    if (config.frames <= 0)
+        return;
+
+    int64_t now = rg_system_timer();
+
+    // Measurements start at the first tick so that the boot and rom loading aren't included
+    if (!bench.frameTimes)
+    {
+        bench.frameTimes = calloc(config.frames, sizeof(int32_t));
+        RG_ASSERT(bench.frameTimes, "Out of memory");
+        bench.startTime = bench.lastTick = now;
+        bench.display = rg_display_get_counters();
+        bench.audio = rg_audio_get_counters();
+        return;
+    }
+
+    bench.frameTimes[bench.frames++] = now - bench.lastTick;
+    bench.busyTime += busyTime;
+    bench.lastTick = now;
+
+    if (bench.frames >= config.frames)
+    {
+        print_report();
+        if (hashes.recording)
+            printf("RG_BENCH golden file recorded: %s\n", config.golden);
+        else if (hashes.fp && hashes.fp != stdout)
+            printf("RG_BENCH golden file matched: %d hashes\n", hashes.compared);
+        if (hashes.fp && hashes.fp != stdout)
+            fclose(hashes.fp);
+        exit(0);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rg_surface.h"
+
+// Headless benchmark mode, configured from the environment (meant for the SDL2 target):
+//   RG_HEADLESS=1      No window, dummy audio sink, no pacing (the core runs as fast as it can)
+//   RG_BENCH_FRAMES=N  Run N frames, print a report on stdout, then exit
+//   RG_BENCH_CORE=nes  Override the app to boot (same as the launcher's configNs: nes, gbc, sms, lnx, ...)
+//   RG_BENCH_ROM=path  Override the rom to load
+//
+// Regression harness, on top of the above:
+//   RG_BENCH_INPUT=path   Scripted input, one "<frame> <keys...>" line per change (eg "120 START A"), the keys
+//                         are held until the next line. Names are UP RIGHT DOWN LEFT SELECT START A B X Y L R.
+//   RG_BENCH_HASH=N       Every N frames, output the hash of the last submitted frame and of the audio since
+//   RG_BENCH_GOLDEN=path  Compare the hashes with this file and exit(1) on the first mismatch. If the file
+//                         doesn't exist it is recorded instead. See retro-core/components/gnuboy/tests/bench.
+//   RG_BENCH_LCD=1        Hash what the emulated LCD shows (scaling, border, OSD) instead of the submitted frames
+//   RG_BENCH_OSD=N        Draw a test pattern on the OSD at frame N, change part of it at 2N, clear it at 3N and
+//                         draw it again in the top left corner at 4N
+//   RG_BENCH_AUDIO=path   Render the audio to this WAV file instead of the dummy sink. Nothing is dropped
+//                         but it still runs faster than real time.
+//   RG_BENCH_SAVE=N       Save the state every N frames (to the cache directory) and report the save latency
+//                         and the time until the emulation resumed
+//   RG_BENCH_DAC=N        Check rg_audio_convert() against the float code it replaced, for every volume and
+//                         sample value, then time both over N passes and exit (1 on mismatch). No core runs.
+typedef struct
+{
+    bool headless;
+    int frames;
+    const char *core;
+    const char *rom;
+    const char *audio;
+    const char *input;
+    int hashInterval;
+    const char *golden;
+    bool lcd;
+    int osdInterval;
+    int saveInterval;
+} rg_bench_config_t;
+
+const rg_bench_config_t *rg_bench_init(void);
+const rg_bench_config_t *rg_bench_get_config(void);
+void rg_bench_tick(int busyTime);
+uint32_t rg_bench_read_input(void);
+void rg_bench_hash_video(const rg_surface_t *update);
+void rg_bench_hash_audio(const void *frames, size_t size);
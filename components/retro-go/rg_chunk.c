@@ -0,0 +1,279 @@
+#include "rg_system.h"
+#include "rg_chunk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CONTAINER_MAGIC   RG_CHUNK_ID('R', 'G', 'S', 'C')
+#define CONTAINER_VERSION (1)
+// Smaller payloads aren't worth the allocations
+#define MIN_COMPRESS_SIZE (128)
+#define HASH_BITS         (12)
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+} container_header_t;
+
+
+static inline uint32_t read32(const uint8_t *ptr)
+{
+    uint32_t value;
+    memcpy(&value, ptr, 4);
+    return value;
+}
+
+static inline size_t write_length(uint8_t *out, size_t length)
+{
+    size_t pos = 0;
+    for (; length >= 255; length -= 255)
+        out[pos++] = 255;
+    out[pos++] = length;
+    return pos;
+}
+
+// Greedy LZ4 block compressor, it's not the fastest or the tightest but it's small and decodes with any
+// LZ4 implementation. Returns 0 if the output doesn't fit in capacity.
+static size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity, uint32_t *table)
+{
+    // The format requires the last match to start 12 bytes before the end and the last 5 bytes to be literals
+    const size_t match_limit = size > 12 ? size - 12 : 0;
+    size_t ip = 0, anchor = 0, op = 0;
+
+    memset(table, 0, sizeof(uint32_t) << HASH_BITS);
+
+    while (ip < match_limit)
+    {
+        uint32_t sequence = read32(src + ip);
+        uint32_t hash = (sequence * 2654435761U) >> (32 - HASH_BITS);
+        size_t ref = table[hash];
+        table[hash] = ip;
+
+        if (ref >= ip || ip - ref > 0xFFFF || read32(src + ref) != sequence)
+        {
+            ip++;
+            continue;
+        }
+
+        size_t length = 4;
+        while (ip + length < size - 5 && src[ref + length] == src[ip + length])
+            length++;
+
+        size_t literals = ip - anchor;
+        if (op + literals + (literals / 255) + ((length - 4) / 255) + 8 > capacity)
+            return 0;
+
+        uint8_t *token = &dst[op++];
+        *token = RG_MIN(literals, 15) << 4 | RG_MIN(length - 4, 15);
+        if (literals >= 15)
+            op += write_length(&dst[op], literals - 15);
+        memcpy(&dst[op], &src[anchor], literals);
+        op += literals;
+        dst[op++] = (ip - ref) & 0xFF;
+        dst[op++] = (ip - ref) >> 8;
+        if (length - 4 >= 15)
+            op += write_length(&dst[op], length - 4 - 15);
+
+        ip += length;
+        anchor = ip;
+    }
+
+    size_t literals = size - anchor;
+    if (op + literals + (literals / 255) + 2 > capacity)
+        return 0;
+
+    dst[op++] = RG_MIN(literals, 15) << 4;
+    if (literals >= 15)
+        op += write_length(&dst[op], literals - 15);
+    memcpy(&dst[op], &src[anchor], literals);
+    op += literals;
+
+    return op;
+}
+
+// Decodes up to capacity bytes, the rest of the block is only validated up to that point
+static bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity, size_t expected)
+{
+    size_t ip = 0, op = 0;
+
+    while (ip < size && op < capacity)
+    {
+        uint8_t token = src[ip++];
+        size_t literals = token >> 4;
+        size_t length = (token & 0xF) + 4;
+        uint8_t byte;
+
+        if (literals == 15)
+        {
+            do
+            {
+                if (ip >= size)
+                    return false;
+                literals += (byte = src[ip++]);
+            } while (byte == 255);
+        }
+
+        if (ip + literals > size)
+            return false;
+        memcpy(&dst[op], &src[ip], RG_MIN(literals, capacity - op));
+        ip += literals;
+        op += literals;
+
+        // The last sequence has no match
+        if (ip == size || op >= capacity)
+            break;
+
+        if (ip + 2 > size)
+            return false;
+        size_t offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return false;
+
+        if ((token & 0xF) == 15)
+        {
+            do
+            {
+                if (ip >= size)
+                    return false;
+                length += (byte = src[ip++]);
+            } while (byte == 255);
+        }
+
+        // Overlapping copies are how runs are encoded, memcpy/memmove won't do
+        for (size_t end = RG_MIN(op + length, capacity); op < end; op++)
+            dst[op] = dst[op - offset];
+    }
+
+    return op >= capacity || op == expected;
+}
+
+uint32_t rg_chunk_id(const char *name)
+{
+    return rg_crc32(0, (const uint8_t *)name, strlen(name));
+}
+
+bool rg_chunk_write_header(FILE *fp)
+{
+    container_header_t header = {CONTAINER_MAGIC, CONTAINER_VERSION, 0};
+    return fwrite(&header, sizeof(header), 1, fp) == 1;
+}
+
+bool rg_chunk_check_header(FILE *fp)
+{
+    container_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != CONTAINER_MAGIC)
+        return false;
+    if (header.version > CONTAINER_VERSION)
+    {
+        RG_LOGE("Container version %d isn't supported!\n", header.version);
+        return false;
+    }
+    return true;
+}
+
+bool rg_chunk_write(FILE *fp, uint32_t id, uint16_t version, const void *data, size_t size, bool compress)
+{
+    rg_chunk_t chunk = {id, version, RG_CHUNK_RAW, size, size};
+    const void *payload = data;
+    uint8_t *buffer = NULL;
+
+    if (compress && size >= MIN_COMPRESS_SIZE)
+    {
+        // If we can't gain at least 1/8th it's not worth the decompression time
+        size_t capacity = size - size / 8;
+        if ((buffer = rg_alloc(capacity + (sizeof(uint32_t) << HASH_BITS), MEM_SLOW | MEM_NOPANIC)))
+        {
+            size_t packed = lz4_compress(data, size, buffer, capacity, (uint32_t *)(buffer + capacity));
+            if (packed > 0)
+            {
+                chunk.flags = RG_CHUNK_LZ4;
+                chunk.stored_size = packed;
+                payload = buffer;
+            }
+        }
+    }
+
+    bool success = fwrite(&chunk, sizeof(chunk), 1, fp) == 1;
+    if (success && chunk.stored_size > 0)
+        success = fwrite(payload, chunk.stored_size, 1, fp) == 1;
+    free(buffer);
+
+    return success;
+}
+
+bool rg_chunk_next(FILE *fp, rg_chunk_t *chunk)
+{
+    return fread(chunk, sizeof(rg_chunk_t), 1, fp) == 1;
+}
+
+bool rg_chunk_skip(FILE *fp, const rg_chunk_t *chunk)
+{
+    return fseek(fp, chunk->stored_size, SEEK_CUR) == 0;
+}
+
+bool rg_chunk_find(FILE *fp, uint32_t id, uint16_t max_version, rg_chunk_t *chunk)
+{
+    long initial_pos = ftell(fp);
+    bool from_start = false;
+
+    // Chunks are usually read in the order they were written, so we start from the current position
+    while (!from_start || ftell(fp) < initial_pos)
+    {
+        if (!rg_chunk_next(fp, chunk))
+        {
+            if (from_start)
+                break;
+            fseek(fp, sizeof(container_header_t), SEEK_SET);
+            from_start = true;
+            continue;
+        }
+        if (chunk->id == id && chunk->version > max_version)
+        {
+            // Written by a newer build, guessing its layout could only corrupt the state
+            RG_LOGW("Chunk %08X is version %d, we only support up to %d!\n", (unsigned)id, chunk->version,
+                    max_version);
+            rg_chunk_skip(fp, chunk);
+            return false;
+        }
+        if (chunk->id == id)
+            return true;
+        if (!rg_chunk_skip(fp, chunk))
+            break;
+    }
+
+    return false;
+}
+
+bool rg_chunk_read(FILE *fp, const rg_chunk_t *chunk, void *buffer, size_t size)
+{
+    size_t wanted = RG_MIN(size, chunk->size);
+    bool success = false;
+
+    if (chunk->flags == RG_CHUNK_RAW)
+    {
+        success = fread(buffer, wanted, 1, fp) == 1 || wanted == 0;
+        fseek(fp, chunk->stored_size - wanted, SEEK_CUR);
+    }
+    else if (chunk->flags == RG_CHUNK_LZ4)
+    {
+        uint8_t *packed = rg_alloc(chunk->stored_size, MEM_SLOW | MEM_NOPANIC);
+        if (packed && fread(packed, chunk->stored_size, 1, fp) == 1)
+            success = lz4_decompress(packed, chunk->stored_size, buffer, wanted, chunk->size);
+        else
+            fseek(fp, chunk->stored_size, SEEK_CUR);
+        free(packed);
+    }
+    else
+    {
+        RG_LOGE("Unknown encoding %d for chunk %08X!\n", chunk->flags, (unsigned)chunk->id);
+        rg_chunk_skip(fp, chunk);
+    }
+
+    if (!success)
+        RG_LOGE("Failed to read chunk %08X!\n", (unsigned)chunk->id);
+
+    return success;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Chunked container that cores can use for their save states. The file starts with a small header followed
+// by any number of chunks: [id][version][flags][size][stored size][payload]. The payload is LZ4 (block
+// format) compressed when it's worth it. Readers can look chunks up by id and skip the ones they don't know,
+// so a chunk can be added (or bumped to a new version) without breaking older or newer builds.
+#define RG_CHUNK_ID(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+typedef enum
+{
+    RG_CHUNK_RAW = 0,
+    RG_CHUNK_LZ4 = 1, // Payload is compressed
+} rg_chunk_flags_t;
+
+typedef struct
+{
+    uint32_t id;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t size;        // Uncompressed size
+    uint32_t stored_size; // Size of the payload in the file
+} rg_chunk_t;
+
+// Ids for cores that name their variables with strings rather than fourcc
+uint32_t rg_chunk_id(const char *name);
+
+bool rg_chunk_write_header(FILE *fp);
+bool rg_chunk_check_header(FILE *fp);
+// compress is a hint, small or incompressible payloads are stored as is
+bool rg_chunk_write(FILE *fp, uint32_t id, uint16_t version, const void *data, size_t size, bool compress);
+// Reads the next chunk's header, the file is then positioned at its payload. The caller must check the version!
+bool rg_chunk_next(FILE *fp, rg_chunk_t *chunk);
+// Looks for a chunk starting from the current position, then from the start of the file. A chunk newer than
+// max_version is treated as missing, older ones are returned and chunk->version tells which layout to expect.
+bool rg_chunk_find(FILE *fp, uint32_t id, uint16_t max_version, rg_chunk_t *chunk);
+// Reads up to `size` bytes of the payload (the rest of buffer is untouched if the chunk is smaller)
+bool rg_chunk_read(FILE *fp, const rg_chunk_t *chunk, void *buffer, size_t size);
+bool rg_chunk_skip(FILE *fp, const rg_chunk_t *chunk);
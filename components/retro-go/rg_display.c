@@ -15,15 +15,67 @@
 
 #define LCD_BUFFER_LENGTH (RG_SCREEN_WIDTH * 4) // In pixels
 
+// Source tiles span the full width of the surface because the LCD window is always updated in full lines
+#define SOURCE_TILE_HEIGHT (8)                      // In lines
+#define SOURCE_TILE_COUNT  (512 / SOURCE_TILE_HEIGHT) // Sources taller than 512 lines will fall back to line checksums
+
+// In interlaced mode a changed block is sent every INTERLACE_FIELDS frames, but never later than INTERLACE_MAX_AGE
+#define INTERLACE_FIELDS  (2)
+#define INTERLACE_MAX_AGE (INTERLACE_FIELDS - 1)
+
+// How long the display task waits for a frame to composite a changed OSD on, before drawing the OSD alone
+#define OSD_IDLE_TIMEOUT (50) // In ms
+
+// Rotation is done in square blocks so that both the reads and the scattered writes stay within a few cache lines
+#define ROTATE_BLOCK_SIZE (16)
+
 static rg_queue_t *display_task_queue;
+static rg_queue_t *display_lock;
+static rg_queue_t *osd_lock;
+// A frame is pending until the display task starts drawing it, it can be replaced by a newer one until then
+static const rg_surface_t *volatile pending_update;
+static const rg_surface_t *volatile current_update;
+static const rg_surface_t *last_update; // Owned by the app, valid as long as it doesn't free it
+static bool display_shutdown;
 static rg_display_counters_t counters;
 static rg_display_config_t config;
 static rg_surface_t *osd;
+static rg_rect_t osd_content; // Area of the OSD that may contain opaque pixels
+static rg_rect_t osd_dirty;   // Area of the OSD that changed since it was last composited
 static rg_surface_t *border;
+static rg_surface_t *rotated;
+static display_rotation_t auto_rotation = RG_DISPLAY_ROTATION_OFF;
 static rg_display_t display;
 static int16_t map_viewport_to_source_x[RG_SCREEN_WIDTH + 1];
 static int16_t map_viewport_to_source_y[RG_SCREEN_HEIGHT + 1];
 static uint32_t screen_line_checksum[RG_SCREEN_HEIGHT + 1];
+static uint8_t screen_line_age[RG_SCREEN_HEIGHT + 1]; // Frames since the line changed without being sent
+static uint32_t source_tile_checksum[SOURCE_TILE_COUNT];
+static bool source_tile_dirty[SOURCE_TILE_COUNT];
+static uint32_t source_palette_checksum;
+
+typedef struct
+{
+    int16_t index;
+    uint8_t weight;
+} filter_tap_t;
+
+// Weights are in 1/FILTER_WEIGHTS steps, blend_lut[w][v] is v * w / FILTER_WEIGHTS for a 5 or 6 bit channel
+#define FILTER_WEIGHTS (16)
+static uint8_t blend_lut[FILTER_WEIGHTS + 1][64];
+static filter_tap_t filter_map_x[RG_SCREEN_WIDTH + 1];
+static filter_tap_t filter_map_y[RG_SCREEN_HEIGHT + 1];
+static uint16_t filter_lines[2][RG_SCREEN_WIDTH];
+static int filter_lines_y[2];
+
+typedef void (*render_line_t)(uint16_t *dst, const void *src, const uint16_t *palette, int width);
+static render_line_t render_line;
+static const char *render_line_name = "none";
+
+#define ACQUIRE_DISPLAY() rg_queue_receive(display_lock, NULL, -1)
+#define RELEASE_DISPLAY() rg_queue_send(display_lock, NULL, 0)
+#define ACQUIRE_OSD() rg_queue_receive(osd_lock, NULL, -1)
+#define RELEASE_OSD() rg_queue_send(osd_lock, NULL, 0)
 
 #define LINE_IS_REPEATED(Y) (map_viewport_to_source_y[(Y)] == map_viewport_to_source_y[(Y) - 1])
 // This is to avoid flooring a number that is approximated to .9999999 and be explicit about it
@@ -35,6 +87,7 @@ static const char *SETTING_FILTER = "DispFilter";
 static const char *SETTING_ROTATION = "DispRotation";
 static const char *SETTING_BORDER = "DispBorder";
 static const char *SETTING_CUSTOM_ZOOM = "DispCustomZoom";
+static const char *SETTING_UPDATE = "DispUpdate";
 
 #ifdef ESP_PLATFORM
 #include <freertos/FreeRTOS.h>
@@ -213,6 +266,12 @@ static inline uint16_t *lcd_get_buffer(void)
     return buffer;
 }
 
+static inline void lcd_put_buffer(uint16_t *buffer)
+{
+    // Return a buffer that wasn't sent
+    xQueueSend(spi_buffers, &buffer, portMAX_DELAY);
+}
+
 static void lcd_sync(void)
 {
     // Unused for SPI LCD
@@ -307,13 +366,125 @@ static void lcd_deinit(void)
     // gpio_reset_pin(RG_GPIO_LCD_BCKL);
     // gpio_reset_pin(RG_GPIO_LCD_DC);
 }
+#elif RG_SCREEN_DRIVER == 99 /* SDL2 */
+// This emulates the LCD controller: pixels sent after lcd_set_window() fill the window line by line.
+// The framebuffer is presented in software (no renderer, no texture) so it works on any host.
+#define SDL_BUFFER_COUNT (4)
+#define SDL_WINDOW_SCALE (2)
+
+static SDL_Window *sdl_window;
+static SDL_Surface *sdl_framebuffer;
+static uint16_t sdl_buffers[SDL_BUFFER_COUNT][LCD_BUFFER_LENGTH];
+static unsigned sdl_next_buffer;
+static struct
+{
+    int left, top, right, bottom;
+    int x, y;
+} sdl_cursor;
+
+static void lcd_set_backlight(float percent)
+{
+    RG_LOGI("backlight set to %d%%\n", (int)percent);
+}
+
+static void lcd_set_window(int left, int top, int width, int height)
+{
+    int right = left + width - 1;
+    int bottom = top + height - 1;
+
+    if (left < 0 || top < 0 || right >= display.screen.real_width || bottom >= display.screen.real_height)
+        RG_LOGW("Bad lcd window (x0=%d, y0=%d, x1=%d, y1=%d)\n", left, top, right, bottom);
+
+    sdl_cursor.left = sdl_cursor.x = left;
+    sdl_cursor.top = sdl_cursor.y = top;
+    sdl_cursor.right = right;
+    sdl_cursor.bottom = bottom;
+}
+
+static inline void lcd_send_data(const uint16_t *buffer, size_t length)
+{
+    if (!sdl_framebuffer)
+        return;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (sdl_cursor.y > sdl_cursor.bottom)
+            break; // The controller ignores data past the end of the window
+        if (sdl_cursor.x >= 0 && sdl_cursor.y >= 0 && sdl_cursor.x < sdl_framebuffer->w && sdl_cursor.y < sdl_framebuffer->h)
+        {
+            uint16_t *line = sdl_framebuffer->pixels + sdl_cursor.y * sdl_framebuffer->pitch;
+            line[sdl_cursor.x] = (buffer[i] << 8) | (buffer[i] >> 8); // Data is big endian, like on the wire
+        }
+        if (++sdl_cursor.x > sdl_cursor.right)
+        {
+            sdl_cursor.x = sdl_cursor.left;
+            sdl_cursor.y++;
+        }
+    }
+}
+
+static inline uint16_t *lcd_get_buffer(void)
+{
+    // Data is copied immediately by lcd_send_data, the buffers only need to outlive a block
+    return sdl_buffers[__atomic_fetch_add(&sdl_next_buffer, 1, __ATOMIC_RELAXED) % SDL_BUFFER_COUNT];
+}
+
+static inline void lcd_put_buffer(uint16_t *buffer)
+{
+    // Nothing to do, buffers aren't owned
+}
+
+static void lcd_sync(void)
+{
+    if (!sdl_window || !sdl_framebuffer)
+        return;
+
+    SDL_Surface *window_surface = SDL_GetWindowSurface(sdl_window);
+    if (window_surface)
+    {
+        SDL_BlitScaled(sdl_framebuffer, NULL, window_surface, NULL);
+        SDL_UpdateWindowSurface(sdl_window);
+    }
+}
+
+static void lcd_init(void)
+{
+    // Null display, write_update() still does all the work but lcd_send_data() drops the pixels.
+    // Unless rg_bench checks the panel's content, then the LCD is emulated but not shown.
+    if (rg_bench_get_config()->headless)
+    {
+        if (rg_bench_get_config()->lcd)
+            sdl_framebuffer = SDL_CreateRGBSurfaceWithFormat(0, display.screen.real_width, display.screen.real_height,
+                                                             16, SDL_PIXELFORMAT_RGB565);
+        return;
+    }
+
+    sdl_window = SDL_CreateWindow(RG_TARGET_NAME, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                  display.screen.real_width * SDL_WINDOW_SCALE,
+                                  display.screen.real_height * SDL_WINDOW_SCALE, SDL_WINDOW_RESIZABLE);
+    sdl_framebuffer = SDL_CreateRGBSurfaceWithFormat(0, display.screen.real_width, display.screen.real_height, 16,
+                                                     SDL_PIXELFORMAT_RGB565);
+    if (!sdl_window || !sdl_framebuffer)
+        RG_LOGE("SDL display init failed: %s\n", SDL_GetError());
+    lcd_set_backlight(config.backlight);
+}
+
+static void lcd_deinit(void)
+{
+    SDL_FreeSurface(sdl_framebuffer);
+    SDL_DestroyWindow(sdl_window);
+    sdl_framebuffer = NULL;
+    sdl_window = NULL;
+}
 #else
 #define lcd_init()
 #define lcd_deinit()
 #define lcd_get_buffer() (void *)0
+#define lcd_put_buffer(b)
 #define lcd_set_backlight(l)
 #define lcd_send_data(a, b)
 #define lcd_set_window(a, b, c, d)
+#define lcd_sync()
 #endif
 
 static inline unsigned blend_pixels(unsigned a, unsigned b)
@@ -334,12 +505,389 @@ static inline unsigned blend_pixels(unsigned a, unsigned b)
     // return (((a ^ b) & 0b1101111011110110U) >> 1) + (a & b);
 }
 
+// Scaler kernels, one per (source format x horizontal step). They're picked once in update_viewport_scaling()
+// so that write_update() doesn't branch on the format or look up the source map when it doesn't need to.
+// Vertical scaling (including 2x line doubling) is handled by write_update() repeating lines.
+#define RENDER_LINE_KERNEL(NAME, PTR_TYPE, PIXEL)                                                      \
+    static void render_##NAME##_1x(uint16_t *dst, const void *src, const uint16_t *palette, int width) \
+    {                                                                                                  \
+        const PTR_TYPE *buffer = src;                                                                  \
+        for (int x = 0; x < width; ++x)                                                                \
+            *dst++ = (PIXEL);                                                                          \
+    }                                                                                                  \
+    static void render_##NAME##_2x(uint16_t *dst, const void *src, const uint16_t *palette, int width) \
+    {                                                                                                  \
+        const PTR_TYPE *buffer = src;                                                                  \
+        for (int x = 0; x < width / 2; ++x)                                                            \
+        {                                                                                              \
+            uint16_t pixel = (PIXEL);                                                                  \
+            *dst++ = pixel;                                                                            \
+            *dst++ = pixel;                                                                            \
+        }                                                                                              \
+    }                                                                                                  \
+    static void render_##NAME##_map(uint16_t *dst, const void *src, const uint16_t *palette, int width)\
+    {                                                                                                  \
+        const PTR_TYPE *buffer = src;                                                                  \
+        for (int xx = 0; xx < width; ++xx)                                                             \
+        {                                                                                              \
+            int x = map_viewport_to_source_x[xx];                                                      \
+            *dst++ = (PIXEL);                                                                          \
+        }                                                                                              \
+    }
+
+RENDER_LINE_KERNEL(pal565, uint8_t, palette[buffer[x]])
+RENDER_LINE_KERNEL(565le, uint16_t, (buffer[x] << 8) | (buffer[x] >> 8))
+RENDER_LINE_KERNEL(565be, uint16_t, buffer[x])
+
+static void render_565be_copy(uint16_t *dst, const void *src, const uint16_t *palette, int width)
+{
+    memcpy(dst, src, width * 2);
+}
+
+static void select_render_line(int format, int src_width, int dst_width)
+{
+    #define SELECT_KERNEL(NAME) \
+        if (dst_width == src_width) render_line = render_##NAME##_1x, render_line_name = #NAME " 1x"; \
+        else if (dst_width == src_width * 2) render_line = render_##NAME##_2x, render_line_name = #NAME " 2x"; \
+        else render_line = render_##NAME##_map, render_line_name = #NAME " map";
+
+    if (format & RG_PIXEL_PALETTE)
+    {
+        SELECT_KERNEL(pal565);
+    }
+    else if (format == RG_PIXEL_565_LE)
+    {
+        SELECT_KERNEL(565le);
+    }
+    else
+    {
+        SELECT_KERNEL(565be);
+        if (render_line == render_565be_1x)
+            render_line = render_565be_copy, render_line_name = "565be copy";
+    }
+
+    #undef SELECT_KERNEL
+}
+
+// Blends two 565LE pixels, the weight applies to b. Costs one table lookup per channel per pixel.
+static inline unsigned blend_weighted(unsigned a, unsigned b, unsigned w)
+{
+    if (w == 0 || a == b)
+        return a;
+    const uint8_t *wa = blend_lut[FILTER_WEIGHTS - w], *wb = blend_lut[w];
+    return ((wa[a >> 11] + wb[b >> 11]) << 11) | ((wa[(a >> 5) & 0x3F] + wb[(b >> 5) & 0x3F]) << 5) |
+           (wa[a & 0x1F] + wb[b & 0x1F]);
+}
+
+static void init_filter_taps(filter_tap_t *map, int count, int src_size, float step, bool area)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        float pos, frac;
+        if (area)
+        {
+            // Coverage of the next source pixel by this output pixel. For downscaling above 2:1 this
+            // is an approximation because only the first and last source pixels are considered.
+            float start = i * step, end = start + step;
+            pos = (int)start;
+            frac = end > pos + 1 ? (end - (pos + 1)) / step : 0.f;
+        }
+        else
+        {
+            pos = RG_MAX((i + 0.5f) * step - 0.5f, 0.f);
+            frac = pos - (int)pos;
+        }
+        map[i].index = RG_MIN((int)pos, src_size - 1);
+        map[i].weight = RG_MIN((int)(frac * FILTER_WEIGHTS + 0.5f), FILTER_WEIGHTS);
+    }
+}
+
+// Renders one source line horizontally filtered into a 565LE line. Returns the cached line if possible.
+static const uint16_t *render_filtered_hline(const void *data, int src_y, int stride, int format,
+                                             const uint16_t *palette, int width, int src_width)
+{
+    int slot = src_y & 1;
+    uint16_t *dst = filter_lines[slot];
+
+    if (filter_lines_y[slot] == src_y)
+        return dst;
+
+    #define RENDER_FILTERED(PTR_TYPE, PIXEL) { \
+        const PTR_TYPE *buffer = data + src_y * stride; \
+        for (int xx = 0; xx < width; ++xx) { \
+            int x = filter_map_x[xx].index; \
+            unsigned a = (PIXEL); \
+            x = RG_MIN(x + 1, src_width - 1); \
+            dst[xx] = blend_weighted(a, (PIXEL), filter_map_x[xx].weight); \
+        } \
+    }
+    if (format & RG_PIXEL_PALETTE)
+        RENDER_FILTERED(uint8_t, (uint16_t)((palette[buffer[x]] << 8) | (palette[buffer[x]] >> 8)))
+    else if (format == RG_PIXEL_565_LE)
+        RENDER_FILTERED(uint16_t, buffer[x])
+    else
+        RENDER_FILTERED(uint16_t, (uint16_t)((buffer[x] << 8) | (buffer[x] >> 8)))
+    #undef RENDER_FILTERED
+
+    filter_lines_y[slot] = src_y;
+    return dst;
+}
+
+#define ROTATE_KERNEL(NAME, PIXEL)                                                                         \
+    static void NAME(PIXEL *dst, int dst_step_x, int dst_step_y, const PIXEL *src, int src_stride, int width, \
+                     int height)                                                                           \
+    {                                                                                                      \
+        for (int by = 0; by < height; by += ROTATE_BLOCK_SIZE)                                             \
+        {                                                                                                  \
+            int block_height = RG_MIN(ROTATE_BLOCK_SIZE, height - by);                                     \
+            for (int bx = 0; bx < width; bx += ROTATE_BLOCK_SIZE)                                          \
+            {                                                                                              \
+                int block_width = RG_MIN(ROTATE_BLOCK_SIZE, width - bx);                                   \
+                for (int y = by; y < by + block_height; ++y)                                               \
+                {                                                                                          \
+                    const PIXEL *src_ptr = src + y * src_stride + bx;                                      \
+                    PIXEL *dst_ptr = dst + y * dst_step_y + bx * dst_step_x;                               \
+                    for (int x = 0; x < block_width; ++x, dst_ptr += dst_step_x)                           \
+                        *dst_ptr = src_ptr[x];                                                             \
+                }                                                                                          \
+            }                                                                                              \
+        }                                                                                                  \
+    }
+
+ROTATE_KERNEL(rotate_8, uint8_t)
+ROTATE_KERNEL(rotate_16, uint16_t)
+
+static display_rotation_t resolve_rotation(void)
+{
+    // AUTO only follows the app's hint, apps that set one also know how to remap their d-pad
+    if (config.rotation != RG_DISPLAY_ROTATION_AUTO)
+        return config.rotation;
+    return auto_rotation;
+}
+
+static const rg_surface_t *rotate_update(const rg_surface_t *update, rg_surface_t *dest, display_rotation_t rotation)
+{
+    const int64_t time_start = rg_system_timer();
+    const int pixel_size = RG_PIXEL_GET_SIZE(update->format);
+    const int src_stride = update->stride / pixel_size;
+    const int dst_stride = dest->stride / pixel_size;
+    const int width = update->width;
+    const int height = update->height;
+    int origin, step_x, step_y;
+
+    if (rotation == RG_DISPLAY_ROTATION_LEFT) // (x, y) => (y, width - 1 - x)
+    {
+        origin = (width - 1) * dst_stride;
+        step_x = -dst_stride;
+        step_y = 1;
+    }
+    else if (rotation == RG_DISPLAY_ROTATION_RIGHT) // (x, y) => (height - 1 - y, x)
+    {
+        origin = height - 1;
+        step_x = dst_stride;
+        step_y = -1;
+    }
+    else // (x, y) => (width - 1 - x, height - 1 - y)
+    {
+        origin = (height - 1) * dst_stride + (width - 1);
+        step_x = -1;
+        step_y = -dst_stride;
+    }
+
+    if (pixel_size == 1)
+        rotate_8((uint8_t *)dest->data + origin, step_x, step_y, update->data + update->offset, src_stride, width, height);
+    else
+        rotate_16((uint16_t *)dest->data + origin, step_x, step_y, update->data + update->offset, src_stride, width, height);
+    dest->palette = update->palette;
+
+    counters.rotateTime[rotation] += rg_system_timer() - time_start;
+    counters.rotatePixels[rotation] += width * height;
+    return dest;
+}
+
+static bool update_source_tiles(const rg_surface_t *update)
+{
+    const void *data = update->data + update->offset;
+    const int line_size = update->width * RG_PIXEL_GET_SIZE(update->format);
+    const int tiles = (update->height + SOURCE_TILE_HEIGHT - 1) / SOURCE_TILE_HEIGHT;
+    bool palette_changed = false;
+
+    if (tiles > SOURCE_TILE_COUNT)
+        return false;
+
+    if (update->format & RG_PIXEL_PALETTE)
+    {
+        uint32_t checksum = rg_hash((void *)update->palette, 256 * 2);
+        palette_changed = checksum != source_palette_checksum;
+        source_palette_checksum = checksum;
+    }
+
+    for (int tile = 0; tile < tiles; ++tile)
+    {
+        int top = tile * SOURCE_TILE_HEIGHT;
+        int height = RG_MIN(SOURCE_TILE_HEIGHT, update->height - top);
+        uint32_t checksum = 0xFFFFFFFF;
+
+        // Hashing line by line is required because stride may not match width
+        for (int y = top; y < top + height; ++y)
+            checksum = (checksum * 31) ^ rg_hash(data + y * update->stride, line_size);
+
+        source_tile_dirty[tile] = palette_changed || checksum != source_tile_checksum[tile];
+        source_tile_checksum[tile] = checksum;
+        counters.tilesDirty += source_tile_dirty[tile];
+    }
+
+    counters.tilesTotal += tiles;
+    return true;
+}
+
+static bool source_lines_dirty(int first, int last, int height)
+{
+    int first_tile = RG_MAX(first, 0) / SOURCE_TILE_HEIGHT;
+    int last_tile = RG_MIN(last, height - 1) / SOURCE_TILE_HEIGHT;
+
+    for (int tile = first_tile; tile <= last_tile; ++tile)
+    {
+        if (source_tile_dirty[tile])
+            return true;
+    }
+    return false;
+}
+
+static bool screen_lines_valid(int top, int count)
+{
+    for (int y = top; y < top + count; ++y)
+    {
+        if (screen_line_checksum[y] == 0)
+            return false;
+    }
+    return true;
+}
+
+static int screen_lines_age(int top, int count)
+{
+    int age = 0;
+    for (int y = top; y < top + count; ++y)
+        age = RG_MAX(age, screen_line_age[y]);
+    return age;
+}
+
+static void rect_union(rg_rect_t *rect, int left, int top, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    if (rect->width <= 0 || rect->height <= 0)
+    {
+        *rect = (rg_rect_t){left, top, width, height};
+        return;
+    }
+    int right = RG_MAX(rect->left + rect->width, left + width);
+    int bottom = RG_MAX(rect->top + rect->height, top + height);
+    rect->left = RG_MIN(rect->left, left);
+    rect->top = RG_MIN(rect->top, top);
+    rect->width = right - rect->left;
+    rect->height = bottom - rect->top;
+}
+
+static bool take_osd_changes(rg_rect_t *area, rg_rect_t *changed)
+{
+    *area = *changed = (rg_rect_t){0};
+
+    if (!osd)
+        return false;
+
+    ACQUIRE_OSD();
+    *area = osd_content;
+    *changed = osd_dirty;
+    osd_dirty = (rg_rect_t){0};
+    RELEASE_OSD();
+
+    // The line checksums don't include the OSD, lines under a change must be sent again
+    for (int y = changed->top; y < changed->top + changed->height; ++y)
+        screen_line_checksum[y] = 0;
+
+    return changed->width > 0;
+}
+
+static void composite_osd(uint16_t *buffer, int left, int top, int width, int height, const rg_rect_t *area)
+{
+    int first_x = RG_MAX(area->left, left);
+    int last_x = RG_MIN(area->left + area->width, left + width);
+    int first_y = RG_MAX(area->top, top);
+    int last_y = RG_MIN(area->top + area->height, top + height);
+
+    for (int y = first_y; y < last_y; ++y)
+    {
+        const uint16_t *src = osd->data + y * osd->stride;
+        uint16_t *dst = buffer + (y - top) * width - left;
+        for (int x = first_x; x < last_x; ++x)
+        {
+            if (src[x] != C_TRANSPARENT)
+                dst[x] = (src[x] << 8) | (src[x] >> 8);
+        }
+    }
+}
+
+static void write_osd_area(int left, int top, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    lcd_set_window(display.screen.margin_left + left, display.screen.margin_top + top, width, height);
+
+    for (int y = top; y < top + height;)
+    {
+        uint16_t *buffer = lcd_get_buffer();
+        uint16_t *buffer_ptr = buffer;
+        int num_lines = RG_MIN(LCD_BUFFER_LENGTH / width, top + height - y);
+
+        for (int line = 0; line < num_lines; ++line, ++y)
+        {
+            // What's under the OSD outside the viewport is the border (or nothing)
+            const uint16_t *src = osd->data + y * osd->stride + left * 2;
+            const uint16_t *below = border ? border->data + y * border->stride + left * 2 : NULL;
+            for (int x = 0; x < width; ++x)
+            {
+                unsigned pixel = src[x] != C_TRANSPARENT ? src[x] : (below ? below[x] : C_BLACK);
+                *buffer_ptr++ = (pixel << 8) | (pixel >> 8);
+            }
+            screen_line_checksum[y] = 0;
+        }
+
+        lcd_send_data(buffer, buffer_ptr - buffer);
+    }
+}
+
+static void write_osd_margins(const rg_rect_t *changed, int draw_left, int draw_top, int draw_width, int draw_height)
+{
+    int left = changed->left, right = changed->left + changed->width;
+    int top = changed->top, bottom = changed->top + changed->height;
+    int draw_right = draw_left + draw_width, draw_bottom = draw_top + draw_height;
+
+    // Above and below the viewport
+    write_osd_area(left, top, changed->width, RG_MIN(bottom, draw_top) - top);
+    write_osd_area(left, RG_MAX(top, draw_bottom), changed->width, bottom - RG_MAX(top, draw_bottom));
+
+    // Left and right of the viewport
+    top = RG_MAX(top, draw_top);
+    bottom = RG_MIN(bottom, draw_bottom);
+    write_osd_area(left, top, RG_MIN(right, draw_left) - left, bottom - top);
+    write_osd_area(RG_MAX(left, draw_right), top, right - RG_MAX(left, draw_right), bottom - top);
+}
+
 static inline void write_update(const rg_surface_t *update)
 {
+    static unsigned field = 0;
+
     const int64_t time_start = rg_system_timer();
 
+    // Everything below works on the rotated copy, it's just another source surface with its own dimensions
+    if (display.viewport.rotation != RG_DISPLAY_ROTATION_OFF && rotated)
+        update = rotate_update(update, rotated, display.viewport.rotation);
+
     bool filter_x = display.viewport.filter_x;
     bool filter_y = display.viewport.filter_y;
+    bool filter_smooth = display.viewport.filter_smooth;
     int draw_left = display.viewport.left;
     int draw_top = display.viewport.top;
     int draw_width = display.viewport.width;
@@ -366,6 +914,7 @@ static inline void write_update(const rg_surface_t *update)
     const int stride = update->stride;
     const void *data = update->data + update->offset + (crop_top * stride) + (crop_left * RG_PIXEL_GET_SIZE(format));
     const uint16_t *palette = update->palette;
+    const render_line_t render = render_line;
 
     int lines_per_buffer = LCD_BUFFER_LENGTH / draw_width;
     int lines_remaining = draw_height;
@@ -373,6 +922,21 @@ static inline void write_update(const rg_surface_t *update)
     int window_top = -1;
     bool partial = true;
 
+    // Diffing the source is much cheaper than scaling and hashing the output, it lets us skip
+    // unchanged blocks before doing any pixel work. The line checksums still catch the rest.
+    bool tiles = config.update_mode != RG_DISPLAY_UPDATE_PARTIAL && update_source_tiles(update);
+    // Interlacing halves the SPI bandwidth of moving scenes by sending alternating blocks of lines every frame
+    bool interlace = tiles && config.update_mode == RG_DISPLAY_UPDATE_INTERLACE;
+    int block = 0;
+
+    field = (field + 1) % INTERLACE_FIELDS;
+
+    // The source changed since the last frame, the cached filtered lines are no longer valid
+    filter_lines_y[0] = filter_lines_y[1] = -1;
+
+    rg_rect_t osd_area, osd_changed;
+    bool osd_margins = take_osd_changes(&osd_area, &osd_changed);
+
     for (int y = 0; y < draw_height;)
     {
         int lines_to_copy = RG_MIN(lines_per_buffer, lines_remaining);
@@ -388,34 +952,66 @@ static inline void write_update(const rg_surface_t *update)
                 --lines_to_copy;
         }
 
+        if (tiles)
+        {
+            // Neighbouring source lines are included because the filters blend across them
+            int first = crop_top + map_viewport_to_source_y[y] - 1;
+            int last = crop_top + map_viewport_to_source_y[y + lines_to_copy - 1] + 1;
+            bool valid = screen_lines_valid(draw_top + y, lines_to_copy);
+            int age = screen_lines_age(draw_top + y, lines_to_copy);
+            bool skip = valid && age == 0 && !source_lines_dirty(first, last, update->height);
+
+            // Lines that changed but aren't in the current field are deferred, unless they're too old
+            if (!skip && interlace && valid && (block % INTERLACE_FIELDS) != field && age < INTERLACE_MAX_AGE)
+            {
+                memset(&screen_line_age[draw_top + y], age + 1, lines_to_copy);
+                skip = true;
+            }
+
+            block++;
+
+            if (skip)
+            {
+                lines_remaining -= lines_to_copy;
+                y += lines_to_copy;
+                continue;
+            }
+        }
+
         uint16_t *line_buffer = lcd_get_buffer();
         uint16_t *line_buffer_ptr = line_buffer;
 
         uint32_t checksum = 0xFFFFFFFF;
         bool need_update = !partial;
+        int64_t render_start = rg_system_timer();
 
         for (int i = 0; i < lines_to_copy; ++i)
         {
-            if (i > 0 && LINE_IS_REPEATED(y))
+            if (filter_smooth)
+            {
+                int src_y = filter_map_y[y].index;
+                int src_width = update->width - crop_left;
+                const uint16_t *lineA = render_filtered_hline(data, src_y, stride, format, palette, draw_width, src_width);
+                const uint16_t *lineB = lineA;
+                unsigned weight = filter_map_y[y].weight;
+                if (weight && src_y + 1 < update->height - crop_top)
+                    lineB = render_filtered_hline(data, src_y + 1, stride, format, palette, draw_width, src_width);
+                for (int x = 0; x < draw_width; ++x)
+                {
+                    unsigned pixel = blend_weighted(lineA[x], lineB[x], weight);
+                    *line_buffer_ptr++ = (pixel << 8) | (pixel >> 8);
+                }
+                checksum = rg_hash((void*)(line_buffer_ptr - draw_width), draw_width * 2);
+            }
+            else if (i > 0 && LINE_IS_REPEATED(y))
             {
                 memcpy(line_buffer_ptr, line_buffer_ptr - draw_width, draw_width * 2);
                 line_buffer_ptr += draw_width;
             }
             else
             {
-                #define RENDER_LINE(PTR_TYPE, PIXEL) { \
-                    PTR_TYPE *buffer = (PTR_TYPE *)(data + map_viewport_to_source_y[y] * stride);\
-                    for (int xx = 0; xx < draw_width; ++xx) { \
-                        int x = map_viewport_to_source_x[xx]; \
-                        *line_buffer_ptr++ = (PIXEL); \
-                    } \
-                }
-                if (format & RG_PIXEL_PALETTE)
-                    RENDER_LINE(uint8_t, palette[buffer[x]])
-                else if (format == RG_PIXEL_565_LE)
-                    RENDER_LINE(uint16_t, (buffer[x] << 8) | (buffer[x] >> 8))
-                else
-                    RENDER_LINE(uint16_t, buffer[x])
+                render(line_buffer_ptr, data + map_viewport_to_source_y[y] * stride, palette, draw_width);
+                line_buffer_ptr += draw_width;
 
                 if (partial)
                 {
@@ -465,6 +1061,13 @@ static inline void write_update(const rg_surface_t *update)
             }
         }
 
+        // The OSD goes on top of everything, including the filters
+        if (osd_area.width > 0 && need_update)
+            composite_osd(line_buffer, draw_left, draw_top + y - lines_to_copy, draw_width, lines_to_copy, &osd_area);
+
+        counters.renderTime += rg_system_timer() - render_start;
+        counters.renderPixels += draw_width * lines_to_copy;
+
         if (need_update)
         {
             int left = display.screen.margin_left + draw_left;
@@ -474,21 +1077,20 @@ static inline void write_update(const rg_surface_t *update)
             lcd_send_data(line_buffer, draw_width * lines_to_copy);
             window_top = top + lines_to_copy;
             lines_updated += lines_to_copy;
+            counters.linesSent += lines_to_copy;
         }
         else
         {
-            // Return buffer
-            xQueueSend(spi_buffers, &line_buffer, portMAX_DELAY);
+            lcd_put_buffer(line_buffer);
         }
 
+        memset(&screen_line_age[draw_top + y - lines_to_copy], 0, lines_to_copy);
         lines_remaining -= lines_to_copy;
     }
 
-    if (osd != NULL)
-    {
-        // TODO: Draw on screen display. By default it should be bottom left which is fine
-        // for both virtual keyboard and info labels. Maybe make it configurable later...
-    }
+    // The parts of the OSD that fall outside the viewport aren't covered by the loop above
+    if (osd_margins)
+        write_osd_margins(&osd_changed, draw_left, draw_top, draw_width, draw_height);
 
     if (lines_updated > display.screen.height * 0.80f)
         counters.fullFrames++;
@@ -499,8 +1101,39 @@ static inline void write_update(const rg_surface_t *update)
 
 static void update_viewport_scaling(void)
 {
-    int src_width = display.source.width;
-    int src_height = display.source.height;
+    display_rotation_t rotation = resolve_rotation();
+    bool transpose = rotation == RG_DISPLAY_ROTATION_LEFT || rotation == RG_DISPLAY_ROTATION_RIGHT;
+    int src_width = transpose ? display.source.height : display.source.width;
+    int src_height = transpose ? display.source.width : display.source.height;
+
+    if (rotation != RG_DISPLAY_ROTATION_OFF && RG_PIXEL_GET_SIZE(display.source.format) > 2)
+    {
+        RG_LOGW("Rotation isn't supported for pixel format 0x%X", display.source.format);
+        rotation = RG_DISPLAY_ROTATION_OFF;
+        src_width = display.source.width;
+        src_height = display.source.height;
+    }
+
+    if (rotation != RG_DISPLAY_ROTATION_OFF && (!rotated || rotated->width != src_width ||
+        rotated->height != src_height || rotated->format != display.source.format))
+    {
+        rg_surface_free(rotated);
+        if (!(rotated = rg_surface_create(src_width, src_height, display.source.format, MEM_ANY)))
+        {
+            RG_LOGE("Failed to allocate rotation buffer, rotation disabled");
+            rotation = RG_DISPLAY_ROTATION_OFF;
+            src_width = display.source.width;
+            src_height = display.source.height;
+        }
+    }
+    else if (rotation == RG_DISPLAY_ROTATION_OFF && rotated)
+    {
+        rg_surface_free(rotated);
+        rotated = NULL;
+    }
+
+    display.viewport.rotation = rotation;
+
     int new_width = src_width;
     int new_height = src_height;
 
@@ -540,17 +1173,31 @@ static void update_viewport_scaling(void)
                                 (config.scaling && (display.viewport.width % src_width) != 0);
     display.viewport.filter_y = (config.filter == RG_DISPLAY_FILTER_VERT || config.filter == RG_DISPLAY_FILTER_BOTH) &&
                                 (config.scaling && (display.viewport.height % src_height) != 0);
+    display.viewport.filter_smooth = (config.filter == RG_DISPLAY_FILTER_BILINEAR || config.filter == RG_DISPLAY_FILTER_AREA) &&
+                                     (config.scaling && (display.viewport.width != src_width || display.viewport.height != src_height));
+
+    if (display.viewport.filter_smooth)
+    {
+        bool area = config.filter == RG_DISPLAY_FILTER_AREA;
+        init_filter_taps(filter_map_x, display.screen.width, src_width, display.viewport.step_x, area);
+        init_filter_taps(filter_map_y, display.screen.height, src_height, display.viewport.step_y, area);
+    }
 
     memset(screen_line_checksum, 0, sizeof(screen_line_checksum));
+    memset(screen_line_age, 0, sizeof(screen_line_age));
+    memset(source_tile_checksum, 0, sizeof(source_tile_checksum));
+
+    select_render_line(display.source.format, src_width, new_width);
 
     for (int x = 0; x < display.screen.width; ++x)
         map_viewport_to_source_x[x] = FLOAT_TO_INT(x * display.viewport.step_x);
     for (int y = 0; y < display.screen.height; ++y)
         map_viewport_to_source_y[y] = FLOAT_TO_INT(y * display.viewport.step_y);
 
-    RG_LOGI("%dx%d@%.3f => %dx%d@%.3f left:%d top:%d step_x:%.2f step_y:%.2f", src_width, src_height,
-            (float)src_width / src_height, new_width, new_height, (float)new_width / new_height,
-            display.viewport.left, display.viewport.top, display.viewport.step_x, display.viewport.step_y);
+    RG_LOGI("%dx%d@%.3f => %dx%d@%.3f left:%d top:%d step_x:%.2f step_y:%.2f kernel:%s rotation:%d", src_width,
+            src_height, (float)src_width / src_height, new_width, new_height, (float)new_width / new_height,
+            display.viewport.left, display.viewport.top, display.viewport.step_x, display.viewport.step_y,
+            render_line_name, rotation);
 }
 
 static bool load_border_file(const char *filename)
@@ -579,21 +1226,51 @@ static bool load_border_file(const char *filename)
 IRAM_ATTR
 static void display_task(void *arg)
 {
-    display_task_queue = rg_queue_create(1, sizeof(rg_surface_t *));
-
     while (1)
     {
-        const rg_surface_t *update;
-
-        rg_queue_peek(display_task_queue, &update, -1);
-        // rg_queue_receive(display_task_queue, &update, -1);
+        // display_task_queue is only used as a wake up signal, the frame itself is in pending_update.
+        // When the OSD changed we give the app a moment to submit a frame to composite it on.
+        ACQUIRE_OSD();
+        bool osd_pending = osd_dirty.width > 0;
+        RELEASE_OSD();
+        bool woken = rg_queue_receive(display_task_queue, NULL, osd_pending ? OSD_IDLE_TIMEOUT : -1);
 
         // Received a shutdown request!
-        if (update == (void *)-1)
+        if (display_shutdown)
             break;
 
+        ACQUIRE_DISPLAY();
+        const rg_surface_t *update = pending_update;
+        // current_update also keeps rg_display_sync() waiting while we draw the OSD alone
+        current_update = update ?: (woken ? NULL : osd);
+        pending_update = NULL;
+        RELEASE_DISPLAY();
+
+        // No frame is coming (paused app, menu, NSF player...), draw the OSD over whatever is on screen.
+        // The lines under it will be sent again with the next frame.
+        if (!update && !woken)
+        {
+            rg_rect_t osd_area, osd_changed;
+            if (take_osd_changes(&osd_area, &osd_changed))
+                write_osd_area(osd_changed.left, osd_changed.top, osd_changed.width, osd_changed.height);
+            current_update = NULL;
+            lcd_sync();
+            continue;
+        }
+
+        // The pending frame was taken back by rg_display_get_free_surface()
+        if (!update)
+            continue;
+
         if (display.changed)
         {
+            // Whatever OSD was on the margins will be erased
+            if (osd)
+            {
+                ACQUIRE_OSD();
+                rect_union(&osd_dirty, osd_content.left, osd_content.top, osd_content.width, osd_content.height);
+                RELEASE_OSD();
+            }
             if (config.scaling != RG_DISPLAY_SCALING_FULL)
             {
                 if (border)
@@ -607,13 +1284,10 @@ static void display_task(void *arg)
 
         write_update(update);
 
-        rg_queue_receive(display_task_queue, &update, -1);
+        current_update = NULL;
 
         lcd_sync();
     }
-
-    rg_queue_free(display_task_queue);
-    display_task_queue = NULL;
 }
 
 void rg_display_force_redraw(void)
@@ -634,6 +1308,24 @@ rg_display_counters_t rg_display_get_counters(void)
     return counters;
 }
 
+bool rg_display_get_lcd(rg_surface_t *out)
+{
+#if RG_SCREEN_DRIVER == 99 /* SDL2 */
+    if (sdl_framebuffer)
+    {
+        *out = (rg_surface_t){
+            .width = sdl_framebuffer->w,
+            .height = sdl_framebuffer->h,
+            .stride = sdl_framebuffer->pitch,
+            .format = RG_PIXEL_565_LE,
+            .data = sdl_framebuffer->pixels,
+        };
+        return true;
+    }
+#endif
+    return false;
+}
+
 void rg_display_set_scaling(display_scaling_t scaling)
 {
     config.scaling = RG_MIN(RG_MAX(0, scaling), RG_DISPLAY_SCALING_COUNT - 1);
@@ -673,10 +1365,31 @@ display_filter_t rg_display_get_filter(void)
 void rg_display_set_rotation(display_rotation_t rotation)
 {
     config.rotation = RG_MIN(RG_MAX(0, rotation), RG_DISPLAY_ROTATION_COUNT - 1);
-    rg_settings_set_number(NS_APP, SETTING_SCALING, config.rotation);
+    rg_settings_set_number(NS_APP, SETTING_ROTATION, config.rotation);
     display.changed = true;
 }
 
+void rg_display_set_auto_rotation(display_rotation_t rotation)
+{
+    // This is a hint from the app (eg a game database entry), it isn't saved
+    auto_rotation = RG_MIN(RG_MAX(0, rotation), RG_DISPLAY_ROTATION_COUNT - 1);
+    if (auto_rotation == RG_DISPLAY_ROTATION_AUTO)
+        auto_rotation = RG_DISPLAY_ROTATION_OFF;
+    display.changed = true;
+}
+
+void rg_display_set_update_mode(display_update_t mode)
+{
+    config.update_mode = RG_MIN(RG_MAX(0, mode), RG_DISPLAY_UPDATE_COUNT - 1);
+    rg_settings_set_number(NS_GLOBAL, SETTING_UPDATE, config.update_mode);
+    display.changed = true;
+}
+
+display_update_t rg_display_get_update_mode(void)
+{
+    return config.update_mode;
+}
+
 display_rotation_t rg_display_get_rotation(void)
 {
     return config.rotation;
@@ -725,15 +1438,27 @@ void rg_display_submit(const rg_surface_t *update, uint32_t flags)
     if (!update || !update->data)
         return;
 
-    if (display.source.width != update->width || display.source.height != update->height)
+    rg_bench_hash_video(update);
+
+    if (display.source.width != update->width || display.source.height != update->height ||
+        display.source.format != update->format)
     {
         rg_display_sync(true);
         display.source.width = update->width;
         display.source.height = update->height;
+        display.source.format = update->format;
         display.changed = true;
     }
 
-    rg_queue_send(display_task_queue, &update, 1000);
+    ACQUIRE_DISPLAY();
+    if (pending_update && pending_update != update)
+        counters.framesReplaced++;
+    pending_update = update;
+    last_update = update;
+    RELEASE_DISPLAY();
+
+    // If the display task is busy the signal is already set and it will pick the newest frame when done
+    rg_queue_send(display_task_queue, NULL, 0);
 
     counters.blockTime += rg_system_timer() - time_start;
     counters.totalFrames++;
@@ -741,9 +1466,130 @@ void rg_display_submit(const rg_surface_t *update, uint32_t flags)
 
 bool rg_display_sync(bool block)
 {
-    while (block && !rg_queue_is_empty(display_task_queue))
+    while (block && (pending_update || current_update))
         continue; // Wait until display queue is done
-    return rg_queue_is_empty(display_task_queue);
+    return !pending_update && !current_update;
+}
+
+const rg_surface_t *rg_display_get_last_update(void)
+{
+    return last_update;
+}
+
+rg_surface_t *rg_display_get_free_surface(rg_surface_t *const *surfaces, size_t count)
+{
+    rg_surface_t *surface = NULL;
+
+    RG_ASSERT(surfaces && count > 0, "Bad param");
+
+    ACQUIRE_DISPLAY();
+    // Prefer a surface that the display task doesn't know about (triple buffering)
+    for (size_t i = 0; i < count && !surface; ++i)
+    {
+        if (surfaces[i] && surfaces[i] != pending_update && surfaces[i] != current_update)
+            surface = surfaces[i];
+    }
+    // Otherwise take back the pending frame, a newer one is coming anyway (double buffering)
+    for (size_t i = 0; i < count && !surface; ++i)
+    {
+        if (surfaces[i] && surfaces[i] == pending_update)
+        {
+            surface = surfaces[i];
+            pending_update = NULL;
+            counters.framesReplaced++;
+        }
+    }
+    RELEASE_DISPLAY();
+
+    // All we have is the surface being drawn (single buffering)
+    if (!surface)
+    {
+        rg_display_sync(true);
+        surface = surfaces[0];
+    }
+
+    return surface;
+}
+
+void rg_display_osd_draw(int left, int top, int width, int height, int stride, const uint16_t *buffer)
+{
+    RG_ASSERT(buffer, "Bad param");
+
+    // Same conventions as rg_display_write()
+    if (left < 0)
+        left += display.screen.width;
+    if (top < 0)
+        top += display.screen.height;
+
+    stride = RG_MAX(stride, width * 2);
+
+    width = RG_MIN(width, display.screen.width - left);
+    height = RG_MIN(height, display.screen.height - top);
+
+    if (width <= 0 || height <= 0 || left < 0 || top < 0)
+        return;
+
+    if (!osd)
+    {
+        // The OSD is allocated on first use, most apps never draw on it
+        rg_surface_t *surface = rg_surface_create(display.screen.width, display.screen.height, RG_PIXEL_565_LE, MEM_SLOW);
+        if (!surface)
+            return;
+        for (size_t i = 0; i < surface->width * surface->height; ++i)
+            ((uint16_t *)surface->data)[i] = C_TRANSPARENT;
+        osd = surface;
+    }
+
+    // Only the pixels that actually changed are marked dirty, redrawing the same thing every frame is free
+    int changed_left = width, changed_right = -1;
+    int changed_top = height, changed_bottom = -1;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint16_t *src = (void *)buffer + y * stride;
+        uint16_t *dst = osd->data + (top + y) * osd->stride + left * 2;
+        for (int x = 0; x < width; ++x)
+        {
+            if (src[x] != C_TRANSPARENT && src[x] != dst[x])
+            {
+                dst[x] = src[x];
+                changed_left = RG_MIN(changed_left, x);
+                changed_right = RG_MAX(changed_right, x);
+                changed_top = RG_MIN(changed_top, y);
+                changed_bottom = RG_MAX(changed_bottom, y);
+            }
+        }
+    }
+
+    if (changed_bottom < 0)
+        return;
+
+    ACQUIRE_OSD();
+    rect_union(&osd_content, left, top, width, height);
+    rect_union(&osd_dirty, left + changed_left, top + changed_top, changed_right - changed_left + 1,
+               changed_bottom - changed_top + 1);
+    RELEASE_OSD();
+
+    rg_queue_send(display_task_queue, NULL, 0);
+}
+
+void rg_display_osd_clear(void)
+{
+    if (!osd)
+        return;
+
+    ACQUIRE_OSD();
+    for (int y = osd_content.top; y < osd_content.top + osd_content.height; ++y)
+    {
+        uint16_t *dst = osd->data + y * osd->stride + osd_content.left * 2;
+        for (int x = 0; x < osd_content.width; ++x)
+            dst[x] = C_TRANSPARENT;
+    }
+    rect_union(&osd_dirty, osd_content.left, osd_content.top, osd_content.width, osd_content.height);
+    osd_content = (rg_rect_t){0};
+    RELEASE_OSD();
+
+    rg_queue_send(display_task_queue, NULL, 0);
 }
 
 void rg_display_write(int left, int top, int width, int height, int stride, const uint16_t *buffer, uint32_t flags)
@@ -827,16 +1673,24 @@ void rg_display_clear(uint16_t color_le)
         lcd_send_data(buffer, pixels);
         y += num_lines;
     }
+
+    // The OSD must be drawn again on top
+    if (osd)
+    {
+        ACQUIRE_OSD();
+        rect_union(&osd_dirty, osd_content.left, osd_content.top, osd_content.width, osd_content.height);
+        RELEASE_OSD();
+        rg_queue_send(display_task_queue, NULL, 0);
+    }
 }
 
 void rg_display_deinit(void)
 {
-    void *stop = (void *)-1;
-    rg_queue_send(display_task_queue, &stop, 1000);
-    // display_task_queue has len == 1. When xQueueSend returns, we know that the only
-    // thing in it is our quit request which won't touch the LCD or SPI anymore
-    // while (display_task_queue)
-    //     rg_task_yield();
+    rg_display_sync(true);
+    display_shutdown = true;
+    last_update = NULL;
+    rg_queue_send(display_task_queue, NULL, 1000);
+    // The display task is idle, it won't touch the LCD or SPI anymore after waking up
     lcd_deinit();
     RG_LOGI("Display terminated.\n");
 }
@@ -852,6 +1706,7 @@ void rg_display_init(void)
         .rotation = rg_settings_get_number(NS_APP, SETTING_ROTATION, RG_DISPLAY_ROTATION_AUTO),
         .border_file = rg_settings_get_string(NS_APP, SETTING_BORDER, NULL),
         .custom_zoom = rg_settings_get_number(NS_APP, SETTING_CUSTOM_ZOOM, 1.0),
+        .update_mode = rg_settings_get_number(NS_GLOBAL, SETTING_UPDATE, RG_DISPLAY_UPDATE_TILES),
     };
     display = (rg_display_t){
         .screen.real_width = RG_SCREEN_WIDTH,
@@ -864,6 +1719,15 @@ void rg_display_init(void)
         .screen.height = RG_SCREEN_HEIGHT - RG_SCREEN_MARGIN_TOP - RG_SCREEN_MARGIN_BOTTOM,
         .changed = true,
     };
+    for (int w = 0; w <= FILTER_WEIGHTS; ++w)
+        for (int v = 0; v < 64; ++v)
+            blend_lut[w][v] = v * w / FILTER_WEIGHTS;
+    display_task_queue = rg_queue_create(1, 0);
+    display_lock = rg_queue_create(1, 0);
+    RELEASE_DISPLAY();
+    osd_lock = rg_queue_create(1, 0);
+    RELEASE_OSD();
+    display_shutdown = false;
     lcd_init();
     rg_task_create("rg_display", &display_task, NULL, 4 * 1024, RG_TASK_PRIORITY_6, 1);
     if (config.border_file)
@@ -18,18 +18,29 @@ typedef enum
     RG_DISPLAY_FILTER_HORIZ,
     RG_DISPLAY_FILTER_VERT,
     RG_DISPLAY_FILTER_BOTH,
+    RG_DISPLAY_FILTER_BILINEAR, // Interpolate between the 4 nearest source pixels
+    RG_DISPLAY_FILTER_AREA,     // Average source pixels by coverage, keeps pixel art sharp
     RG_DISPLAY_FILTER_COUNT,
 } display_filter_t;
 
 typedef enum
 {
     RG_DISPLAY_ROTATION_OFF = 0,
-    RG_DISPLAY_ROTATION_AUTO,
-    RG_DISPLAY_ROTATION_LEFT,
-    RG_DISPLAY_ROTATION_RIGHT,
+    RG_DISPLAY_ROTATION_AUTO,   // Use the app's hint (rg_display_set_auto_rotation), off if it has none
+    RG_DISPLAY_ROTATION_LEFT,   // 90 degrees counter-clockwise
+    RG_DISPLAY_ROTATION_RIGHT,  // 90 degrees clockwise
+    RG_DISPLAY_ROTATION_INVERT, // 180 degrees
     RG_DISPLAY_ROTATION_COUNT,
 } display_rotation_t;
 
+typedef enum
+{
+    RG_DISPLAY_UPDATE_PARTIAL = 0, // Send lines whose scaled output checksum changed
+    RG_DISPLAY_UPDATE_TILES,       // Also skip lines whose source tiles didn't change, before scaling them
+    RG_DISPLAY_UPDATE_INTERLACE,   // Like tiles but changed blocks of lines are sent on alternating frames
+    RG_DISPLAY_UPDATE_COUNT,
+} display_update_t;
+
 typedef enum
 {
     RG_DISPLAY_BACKLIGHT_MIN = 1,
@@ -50,6 +61,7 @@ typedef struct
     display_backlight_t backlight;
     char *border_file;
     double custom_zoom;
+    display_update_t update_mode;
 } rg_display_config_t;
 
 typedef struct
@@ -57,8 +69,16 @@ typedef struct
     int32_t totalFrames;
     int32_t fullFrames;
     int32_t partFrames;
+    int32_t framesReplaced; // Frames dropped because a newer one was submitted before they were drawn
     int64_t blockTime;
     int64_t busyTime;
+    int64_t tilesTotal;
+    int64_t tilesDirty;
+    int64_t renderTime;
+    int64_t renderPixels;
+    int64_t linesSent;
+    int64_t rotateTime[RG_DISPLAY_ROTATION_COUNT];   // Indexed by the rotation that was applied
+    int64_t rotatePixels[RG_DISPLAY_ROTATION_COUNT];
 } rg_display_counters_t;
 
 typedef struct
@@ -75,11 +95,13 @@ typedef struct
         int top, left;
         int width, height;
         float step_x, step_y;
-        bool filter_x, filter_y;
+        bool filter_x, filter_y, filter_smooth;
+        display_rotation_t rotation; // Never AUTO
     } viewport;
     struct
     {
         int width, height;
+        int format;
     } source;
     bool changed;
 } rg_display_t;
@@ -93,8 +115,18 @@ void rg_display_clear(uint16_t color_le);
 bool rg_display_sync(bool block);
 void rg_display_force_redraw(void);
 void rg_display_submit(const rg_surface_t *update, uint32_t flags);
+// Returns a surface the display task isn't using, NULL entries are ignored (optional third buffer)
+rg_surface_t *rg_display_get_free_surface(rg_surface_t *const *surfaces, size_t count);
+// Last surface passed to rg_display_submit, the app may be drawing into it again!
+const rg_surface_t *rg_display_get_last_update(void);
+
+// The OSD is a screen-sized layer composited on top of every frame, C_TRANSPARENT pixels are skipped
+void rg_display_osd_draw(int left, int top, int width, int height, int stride, const uint16_t *buffer);
+void rg_display_osd_clear(void);
 
 rg_display_counters_t rg_display_get_counters(void);
+// What the panel currently shows (after scaling, borders and OSD), only the SDL2 target's emulated LCD has it
+bool rg_display_get_lcd(rg_surface_t *out);
 const rg_display_t *rg_display_get_info(void);
 
 void rg_display_set_scaling(display_scaling_t scaling);
@@ -103,6 +135,9 @@ void rg_display_set_filter(display_filter_t filter);
 display_filter_t rg_display_get_filter(void);
 void rg_display_set_rotation(display_rotation_t rotation);
 display_rotation_t rg_display_get_rotation(void);
+void rg_display_set_auto_rotation(display_rotation_t rotation);
+void rg_display_set_update_mode(display_update_t mode);
+display_update_t rg_display_get_update_mode(void);
 void rg_display_set_backlight(display_backlight_t percent);
 display_backlight_t rg_display_get_backlight(void);
 void rg_display_set_border(const char *filename);
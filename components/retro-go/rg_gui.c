@@ -33,6 +33,7 @@ static struct
     cJSON *theme_obj;
     int font_index;
     bool show_clock;
+    bool draw_osd;
     bool initialized;
 } gui;
 
@@ -218,6 +219,11 @@ void rg_gui_set_surface(rg_surface_t *surface)
     gui.screen_buffer = surface ? surface->data : NULL;
 }
 
+void rg_gui_set_osd(bool enable)
+{
+    gui.draw_osd = enable;
+}
+
 void rg_gui_copy_buffer(int left, int top, int width, int height, int stride, const void *buffer)
 {
     left = get_horizontal_position(left, width);
@@ -240,6 +246,10 @@ void rg_gui_copy_buffer(int left, int top, int width, int height, int stride, co
                     dst[x] = src[x];
         }
     }
+    else if (gui.draw_osd)
+    {
+        rg_display_osd_draw(left, top, width, height, stride, buffer);
+    }
     else
     {
         rg_display_write(left, top, width, height, stride, buffer, 0);
@@ -1102,6 +1112,38 @@ static rg_gui_event_t audio_update_cb(rg_gui_option_t *option, rg_gui_event_t ev
     return RG_DIALOG_VOID;
 }
 
+static rg_gui_event_t audio_filter_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    const int presets[] = {
+        0,
+        RG_AUDIO_FILTER_DCBLOCK | RG_AUDIO_FILTER_SOFTCLIP,
+        RG_AUDIO_FILTER_DCBLOCK | RG_AUDIO_FILTER_SOFTCLIP | RG_AUDIO_FILTER_LOWPASS,
+        RG_AUDIO_FILTER_DCBLOCK | RG_AUDIO_FILTER_SOFTCLIP | RG_AUDIO_FILTER_LOWPASS | RG_AUDIO_FILTER_STEREO,
+    };
+    const char *names[] = {"Off", "Clean", "Soft", "Wide"};
+    int max = RG_COUNT(presets) - 1;
+    int filter = rg_audio_get_filter();
+    int preset = -1;
+
+    for (int i = 0; i <= max; ++i)
+        if (presets[i] == filter)
+            preset = i;
+
+    int prev_preset = preset;
+
+    if (event == RG_DIALOG_PREV && --preset < 0)
+        preset = max;
+    if (event == RG_DIALOG_NEXT && ++preset > max)
+        preset = 0;
+
+    if (preset != prev_preset)
+        rg_audio_set_filter(presets[preset]);
+
+    strcpy(option->value, preset < 0 ? "Custom" : names[preset]);
+
+    return RG_DIALOG_VOID;
+}
+
 static rg_gui_event_t filter_update_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     int max = RG_DISPLAY_FILTER_COUNT - 1;
@@ -1127,6 +1169,10 @@ static rg_gui_event_t filter_update_cb(rg_gui_option_t *option, rg_gui_event_t e
         strcpy(option->value, "Vert ");
     if (mode == RG_DISPLAY_FILTER_BOTH)
         strcpy(option->value, "Both ");
+    if (mode == RG_DISPLAY_FILTER_BILINEAR)
+        strcpy(option->value, "Bilinear");
+    if (mode == RG_DISPLAY_FILTER_AREA)
+        strcpy(option->value, "Area ");
 
     return RG_DIALOG_VOID;
 }
@@ -1191,6 +1237,29 @@ static rg_gui_event_t overclock_update_cb(rg_gui_option_t *option, rg_gui_event_
     return RG_DIALOG_VOID;
 }
 
+static rg_gui_event_t update_mode_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    int max = RG_DISPLAY_UPDATE_COUNT - 1;
+    int mode = rg_display_get_update_mode();
+
+    if (event == RG_DIALOG_PREV && --mode < 0)
+        mode = max;
+    if (event == RG_DIALOG_NEXT && ++mode > max)
+        mode = 0;
+
+    if (mode != rg_display_get_update_mode())
+        rg_display_set_update_mode(mode);
+
+    if (mode == RG_DISPLAY_UPDATE_PARTIAL)
+        strcpy(option->value, "Lines");
+    if (mode == RG_DISPLAY_UPDATE_TILES)
+        strcpy(option->value, "Tiles");
+    if (mode == RG_DISPLAY_UPDATE_INTERLACE)
+        strcpy(option->value, "Interlaced");
+
+    return RG_DIALOG_VOID;
+}
+
 static rg_gui_event_t speedup_update_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
@@ -1202,6 +1271,16 @@ static rg_gui_event_t speedup_update_cb(rg_gui_option_t *option, rg_gui_event_t
     return RG_DIALOG_VOID;
 }
 
+static rg_gui_event_t rewind_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
+    {
+        rg_emu_set_rewind(!rg_emu_get_rewind());
+    }
+    strcpy(option->value, rg_emu_get_rewind() ? "On " : "Off");
+    return RG_DIALOG_VOID;
+}
+
 static rg_gui_event_t disk_activity_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
@@ -1320,6 +1399,7 @@ void rg_gui_options_menu(void)
     *opt++ = (rg_gui_option_t){0, "Brightness", "-", RG_DIALOG_FLAG_NORMAL, &brightness_update_cb};
     *opt++ = (rg_gui_option_t){0, "Volume    ", "-", RG_DIALOG_FLAG_NORMAL, &volume_update_cb};
     *opt++ = (rg_gui_option_t){0, "Audio out ", "-", RG_DIALOG_FLAG_NORMAL, &audio_update_cb};
+    *opt++ = (rg_gui_option_t){0, "Audio fx  ", "-", RG_DIALOG_FLAG_NORMAL, &audio_filter_cb};
 
     // Global settings that aren't essential to show when inside a game
     if (app->isLauncher)
@@ -1338,6 +1418,8 @@ void rg_gui_options_menu(void)
         *opt++ = (rg_gui_option_t){0, "Filter",    "-", RG_DIALOG_FLAG_NORMAL, &filter_update_cb};
         *opt++ = (rg_gui_option_t){0, "Border",    "-", RG_DIALOG_FLAG_NORMAL, &border_update_cb};
         *opt++ = (rg_gui_option_t){0, "Speed",     "-", RG_DIALOG_FLAG_NORMAL, &speedup_update_cb};
+        if (app->handlers.saveStateMem)
+            *opt++ = (rg_gui_option_t){0, "Rewind",    "-", RG_DIALOG_FLAG_NORMAL, &rewind_cb};
     }
 
     size_t extra_options = get_dialog_items_count(app->options);
@@ -1411,6 +1493,8 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
     char stack_hwm[20], heap_free[20], block_free[20];
     char local_time[32], timezone[32], uptime[20];
     char battery_info[25], frame_time[32];
+    char dirty_tiles[20], scaler_speed[20], frames_replaced[20], lines_sent[20], rotate_speed[24];
+    char audio_buffer[24], resampler[24], rewind_info[24], run_ahead[24], pager_info[24];
     char app_name[32], network_str[64];
 
     const rg_gui_option_t options[] = {
@@ -1427,8 +1511,19 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
         {0, "Uptime    ", uptime,       RG_DIALOG_FLAG_NORMAL, NULL},
         {0, "Battery   ", battery_info, RG_DIALOG_FLAG_NORMAL, NULL},
         {0, "Blit time ", frame_time,   RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Dirty tiles", dirty_tiles, RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Scaler    ", scaler_speed, RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Rotation  ", rotate_speed, RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Replaced  ", frames_replaced, RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Lines sent", lines_sent,   RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Audio buf ", audio_buffer, RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Resampler ", resampler,    RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Rewind    ", rewind_info,  RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "Run-ahead ", run_ahead,    RG_DIALOG_FLAG_NORMAL, NULL},
+        {0, "ROM pager ", pager_info,   RG_DIALOG_FLAG_NORMAL, NULL},
         RG_DIALOG_SEPARATOR,
         {0, "Overclock", "-", RG_DIALOG_FLAG_NORMAL, &overclock_update_cb},
+        {0, "Update   ", "-", RG_DIALOG_FLAG_NORMAL, &update_mode_cb},
         {1, "Reboot to firmware", NULL, RG_DIALOG_FLAG_NORMAL, NULL},
         {2, "Clear cache    ", NULL, RG_DIALOG_FLAG_NORMAL, NULL},
         {3, "Save screenshot", NULL, RG_DIALOG_FLAG_NORMAL, NULL},
@@ -1436,11 +1531,15 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
         {5, "Cheats    ", NULL, RG_DIALOG_FLAG_NORMAL, NULL},
         {6, "Crash     ", NULL, RG_DIALOG_FLAG_NORMAL, NULL},
         {7, "Log=debug ", NULL, RG_DIALOG_FLAG_NORMAL, NULL},
+        {8, rg_audio_capture_active() ? "Stop recording" : "Record audio", NULL, RG_DIALOG_FLAG_NORMAL, NULL},
         RG_DIALOG_END
     };
 
     const rg_display_t *display = rg_display_get_info();
     rg_display_counters_t display_stats = rg_display_get_counters();
+    rg_audio_counters_t audio_stats = rg_audio_get_counters();
+    rg_rewind_counters_t rewind_stats = rg_rewind_get_counters();
+    rg_pager_counters_t pager_stats = rg_pager_get_counters();
     rg_stats_t stats = rg_system_get_counters();
     time_t now = time(NULL);
 
@@ -1457,6 +1556,64 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
     }
     else
         snprintf(frame_time, 20, "N/A");
+    if (display_stats.tilesTotal > 0)
+        snprintf(dirty_tiles, 20, "%d%%", (int)(display_stats.tilesDirty * 100 / display_stats.tilesTotal));
+    else
+        snprintf(dirty_tiles, 20, "N/A");
+    if (display_stats.renderTime > 0)
+    {
+        int frames = RG_MAX(display_stats.fullFrames + display_stats.partFrames, 1);
+        snprintf(scaler_speed, 20, "%.1fms (%.1fpx/us)", display_stats.renderTime / 1000.f / frames,
+                 (float)display_stats.renderPixels / display_stats.renderTime);
+    }
+    else
+        snprintf(scaler_speed, 20, "N/A");
+    const char *rotations[] = {"Off", "Auto", "Left", "Right", "Invert"};
+    display_rotation_t rotation = display->viewport.rotation;
+    if (display_stats.rotateTime[rotation] > 0)
+    {
+        int frames = RG_MAX(display_stats.fullFrames + display_stats.partFrames, 1);
+        snprintf(rotate_speed, 24, "%s %.1fms (%.0fpx/us)", rotations[rotation],
+                 display_stats.rotateTime[rotation] / 1000.f / frames,
+                 (float)display_stats.rotatePixels[rotation] / display_stats.rotateTime[rotation]);
+    }
+    else
+        snprintf(rotate_speed, 24, "%s", rotations[rotation]);
+    if (display_stats.fullFrames + display_stats.partFrames > 0)
+        snprintf(lines_sent, 20, "%d/frame", (int)(display_stats.linesSent / (display_stats.fullFrames + display_stats.partFrames)));
+    else
+        snprintf(lines_sent, 20, "N/A");
+    // Fill level, underruns (sink starved), overruns (frames dropped)
+    snprintf(audio_buffer, 24, "%d u:%d o:%d", (int)audio_stats.bufferFill, (int)audio_stats.underruns,
+             (int)audio_stats.overruns);
+    if (audio_stats.resampleTime > 0)
+        snprintf(resampler, 24, "%+.2f%% (%.1fsmp/us)", audio_stats.drcAdjust / 10000.f,
+                 (float)audio_stats.resampleFrames / audio_stats.resampleTime);
+    else
+        snprintf(resampler, 24, "%+.2f%%", audio_stats.drcAdjust / 10000.f);
+    // Cost of a snapshot, memory per second of history, length of the history
+    int tick_rate = RG_MAX(rg_system_get_app()->tickRate, 1);
+    if (rewind_stats.captures > 0 && rewind_stats.historyTicks > 0)
+        snprintf(rewind_info, 24, "%.1fms %dKB/s %ds", rewind_stats.captureTime / 1000.f / rewind_stats.captures,
+                 (int)((int64_t)rewind_stats.historyBytes * tick_rate / rewind_stats.historyTicks / 1024),
+                 (int)(rewind_stats.historyTicks / tick_rate));
+    else
+        snprintf(rewind_info, 24, rg_rewind_enabled() ? "On" : "Off");
+    // Frames, input lag removed, CPU cost
+    if (stats.runAheadFrames > 0)
+        snprintf(run_ahead, 24, "%d -%.1fms %.0f%%", stats.runAheadFrames, stats.runAheadLatency,
+                 stats.runAheadPercent);
+    else
+        snprintf(run_ahead, 24, "Off");
+    // Hit rate, resident memory, average and worst stall
+    if (pager_stats.misses > 0)
+        snprintf(pager_info, 24, "%d%% %dKB %.1f/%dms",
+                 (int)((int64_t)pager_stats.hits * 100 / (pager_stats.hits + pager_stats.misses)),
+                 (int)(pager_stats.residentBytes / 1024), pager_stats.stallTime / 1000.f / pager_stats.misses,
+                 (int)(pager_stats.maxStallTime / 1000));
+    else
+        snprintf(pager_info, 24, "Off");
+    snprintf(frames_replaced, 20, "%d/%d", display_stats.framesReplaced, display_stats.totalFrames);
     snprintf(stack_hwm, 20, "%d", stats.freeStackMain);
     snprintf(heap_free, 20, "%d+%d", stats.freeMemoryInt, stats.freeMemoryExt);
     snprintf(block_free, 20, "%d+%d", stats.freeBlockInt, stats.freeBlockExt);
@@ -1508,6 +1665,12 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
     case 7:
         rg_system_set_log_level(RG_LOG_DEBUG);
         break;
+    case 8:
+        if (rg_audio_capture_active())
+            rg_audio_capture_stop();
+        else
+            rg_audio_capture_start(RG_STORAGE_ROOT "/audio.wav");
+        break;
     }
 }
 
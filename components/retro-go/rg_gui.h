@@ -94,6 +94,7 @@ struct rg_gui_option_s
 
 void rg_gui_init(void);
 void rg_gui_set_surface(rg_surface_t *surface);
+void rg_gui_set_osd(bool enable); // Draw on the display's OSD layer instead of the screen
 bool rg_gui_set_font(int index);
 bool rg_gui_set_theme(const char *name);
 const char *rg_gui_get_theme_name(void);
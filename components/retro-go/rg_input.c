@@ -306,6 +306,8 @@ uint32_t rg_input_read_gamepad(void)
 #ifdef RG_TARGET_SDL2
     SDL_PumpEvents();
 #endif
+    if (rg_bench_get_config()->input)
+        return rg_bench_read_input();
     return gamepad_state;
 }
 
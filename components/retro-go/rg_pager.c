@@ -0,0 +1,232 @@
+#include "rg_system.h"
+#include "rg_pager.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Memory left to the rest of the system when picking a budget
+#define RESERVED_MEMORY (64 * 1024)
+// The default budget is half of the free memory, up to this
+#define MAX_DEFAULT_BUDGET (2 * 1024 * 1024)
+
+typedef struct
+{
+    uint8_t *data;
+    uint32_t stamp; // Last time the frame was mapped
+    int32_t page;   // -1 if the frame is free
+    uint16_t pins;  // Slots pointing to this frame
+} frame_t;
+
+struct rg_pager_s
+{
+    FILE *fp;
+    size_t offset;
+    size_t size;
+    size_t page_size;
+    size_t pages;
+    size_t slots;
+    size_t max_frames;
+    size_t used_frames;
+    int32_t *page_frame; // [pages], -1 if not resident
+    int32_t *slot_page;  // [slots], -1 if not mapped
+    frame_t *frames;     // [max_frames]
+    uint32_t clock;
+    rg_pager_filter_t filter;
+    void *filter_arg;
+};
+
+static rg_pager_counters_t counters;
+
+
+bool rg_pager_wanted(size_t size)
+{
+    size_t largest = 0;
+    rg_free_memory(MEM_ANY, &largest);
+    return size + RESERVED_MEMORY > largest;
+}
+
+rg_pager_t *rg_pager_open(const char *path, size_t offset, size_t size, size_t page_size, size_t slots, size_t budget)
+{
+    RG_ASSERT(path && page_size && slots, "bad param");
+
+    rg_pager_t *pager = calloc(1, sizeof(rg_pager_t));
+    if (!pager)
+        return NULL;
+
+    if (budget == 0)
+    {
+        size_t available = rg_free_memory(MEM_ANY, NULL);
+        budget = available > RESERVED_MEMORY ? RG_MIN((available - RESERVED_MEMORY) / 2, MAX_DEFAULT_BUDGET) : 0;
+    }
+
+    pager->offset = offset;
+    pager->size = size;
+    pager->page_size = page_size;
+    pager->pages = RG_MAX((size + page_size - 1) / page_size, 1);
+    pager->slots = slots;
+    pager->max_frames = RG_MIN(RG_MAX(budget / page_size, slots + 1), pager->pages);
+    pager->page_frame = malloc(pager->pages * sizeof(int32_t));
+    pager->slot_page = malloc(slots * sizeof(int32_t));
+    pager->frames = calloc(pager->max_frames, sizeof(frame_t));
+    pager->fp = fopen(path, "rb");
+
+    if (!pager->fp || !pager->page_frame || !pager->slot_page || !pager->frames)
+    {
+        RG_LOGE("Failed to open '%s' for paging!\n", path);
+        rg_pager_close(pager);
+        return NULL;
+    }
+
+    // We do our own buffering
+    setvbuf(pager->fp, NULL, _IONBF, 0);
+
+    memset(pager->page_frame, 0xFF, pager->pages * sizeof(int32_t));
+    memset(pager->slot_page, 0xFF, slots * sizeof(int32_t));
+    for (size_t i = 0; i < pager->max_frames; i++)
+        pager->frames[i].page = -1;
+
+    memset(&counters, 0, sizeof(counters));
+    counters.romBytes = size;
+
+    RG_LOGI("Paging '%s': %d pages of %dKB, %d slots, up to %d frames (%dKB)\n", path, (int)pager->pages,
+            (int)(page_size / 1024), (int)slots, (int)pager->max_frames, (int)(pager->max_frames * page_size / 1024));
+
+    return pager;
+}
+
+void rg_pager_close(rg_pager_t *pager)
+{
+    if (!pager)
+        return;
+    if (pager->fp)
+        fclose(pager->fp);
+    for (size_t i = 0; i < pager->used_frames; i++)
+        free(pager->frames[i].data);
+    free(pager->page_frame);
+    free(pager->slot_page);
+    free(pager->frames);
+    free(pager);
+    counters.residentBytes = 0;
+}
+
+void rg_pager_set_filter(rg_pager_t *pager, rg_pager_filter_t filter, void *arg)
+{
+    RG_ASSERT(pager, "bad param");
+    pager->filter = filter;
+    pager->filter_arg = arg;
+}
+
+bool rg_pager_read(rg_pager_t *pager, size_t address, void *buffer, size_t size)
+{
+    RG_ASSERT(pager && buffer, "bad param");
+    if (address + size > pager->size)
+        return false;
+    if (fseek(pager->fp, pager->offset + address, SEEK_SET) != 0)
+        return false;
+    return fread(buffer, size, 1, pager->fp) == 1 || size == 0;
+}
+
+static frame_t *get_frame(rg_pager_t *pager)
+{
+    frame_t *victim = NULL;
+
+    if (pager->used_frames < pager->max_frames)
+    {
+        frame_t *frame = &pager->frames[pager->used_frames];
+        if ((frame->data = rg_alloc(pager->page_size, MEM_SLOW | MEM_NOPANIC)))
+        {
+            pager->used_frames++;
+            counters.residentBytes += pager->page_size;
+            return frame;
+        }
+        // Out of memory, we'll have to make do with what we have
+        pager->max_frames = pager->used_frames;
+    }
+
+    for (size_t i = 0; i < pager->used_frames; i++)
+    {
+        frame_t *frame = &pager->frames[i];
+        if (frame->page < 0)
+            return frame;
+        if (frame->pins == 0 && (!victim || frame->stamp < victim->stamp))
+            victim = frame;
+    }
+
+    if (victim)
+    {
+        pager->page_frame[victim->page] = -1;
+        victim->page = -1;
+        counters.evictions++;
+    }
+
+    return victim;
+}
+
+uint8_t *rg_pager_map(rg_pager_t *pager, size_t slot, size_t address)
+{
+    RG_ASSERT(pager && slot < pager->slots, "bad param");
+
+    address %= pager->pages * pager->page_size;
+
+    int32_t page = address / pager->page_size;
+    size_t page_offset = address % pager->page_size;
+    int32_t index = pager->page_frame[page];
+
+    // The common case, the core is recomputing its memory map
+    if (pager->slot_page[slot] == page)
+        return pager->frames[index].data + page_offset;
+
+    pager->clock++;
+
+    // Unpin the previous page first, so that it can be reclaimed
+    if (pager->slot_page[slot] >= 0)
+        pager->frames[pager->page_frame[pager->slot_page[slot]]].pins--;
+
+    if (index >= 0)
+    {
+        counters.hits++;
+    }
+    else
+    {
+        int64_t start = rg_system_timer();
+        frame_t *frame = get_frame(pager);
+        RG_ASSERT(frame, "All frames are pinned!");
+
+        size_t page_address = (size_t)page * pager->page_size;
+        size_t length = RG_MIN(pager->page_size, pager->size - RG_MIN(page_address, pager->size));
+        if (!rg_pager_read(pager, page_address, frame->data, length))
+            RG_LOGE("Failed to read page %d!\n", (int)page);
+        memset(frame->data + length, 0xFF, pager->page_size - length);
+        if (pager->filter)
+            pager->filter(frame->data, pager->page_size, pager->filter_arg);
+
+        frame->page = page;
+        index = frame - pager->frames;
+        pager->page_frame[page] = index;
+
+        int elapsed = rg_system_timer() - start;
+        counters.stallTime += elapsed;
+        counters.maxStallTime = RG_MAX(counters.maxStallTime, elapsed);
+        counters.misses++;
+    }
+
+    frame_t *frame = &pager->frames[index];
+    frame->stamp = pager->clock;
+    frame->pins++;
+    pager->slot_page[slot] = page;
+
+    return frame->data + page_offset;
+}
+
+long rg_pager_get_mapping(rg_pager_t *pager, size_t slot)
+{
+    RG_ASSERT(pager && slot < pager->slots, "bad param");
+    if (pager->slot_page[slot] < 0)
+        return -1;
+    return (long)pager->slot_page[slot] * pager->page_size;
+}
+
+rg_pager_counters_t rg_pager_get_counters(void)
+{
+    return counters;
+}
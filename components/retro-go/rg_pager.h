@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// The pager lets a core run a ROM that doesn't fit in memory. The ROM stays on the disk and pages are read
+// into a fixed number of frames as the core maps them. The core maps pages into `slots` (its bank windows,
+// eg the 8 MPRs of the PC Engine) and gets a pointer it can hand to its memory map. A page stays resident
+// as long as a slot points to it; the least recently mapped unpinned page is reclaimed when we need a frame.
+typedef struct
+{
+    int32_t hits;          // Slot remaps to a resident page
+    int32_t misses;        // Slot remaps that had to read from the disk
+    int32_t evictions;     // Pages dropped to make room
+    int64_t stallTime;     // Time spent reading pages (us)
+    int32_t maxStallTime;  // Longest read (us)
+    int32_t residentBytes; // Memory used by the frames
+    int32_t romBytes;      // Size of the paged ROM
+} rg_pager_counters_t;
+
+typedef struct rg_pager_s rg_pager_t;
+
+// Called after a page is read, for cores that need to patch or decrypt ROM data
+typedef void (*rg_pager_filter_t)(uint8_t *data, size_t size, void *arg);
+
+// True if a ROM of `size` bytes would leave too little memory for the rest of the system
+bool rg_pager_wanted(size_t size);
+// `offset` is where the ROM data starts in the file (after any header). `budget` is the memory allowed for
+// frames, 0 to pick one based on free memory. There are always at least slots + 1 frames.
+rg_pager_t *rg_pager_open(const char *path, size_t offset, size_t size, size_t page_size, size_t slots, size_t budget);
+void rg_pager_close(rg_pager_t *pager);
+void rg_pager_set_filter(rg_pager_t *pager, rg_pager_filter_t filter, void *arg);
+// Maps the page containing `address` into `slot` and returns a pointer to `address`. Addresses wrap around.
+uint8_t *rg_pager_map(rg_pager_t *pager, size_t slot, size_t address);
+// Returns the address of the page mapped in `slot`, or -1
+long rg_pager_get_mapping(rg_pager_t *pager, size_t slot);
+// Reads raw ROM data, bypassing the cache and the filter (for headers, checksums, etc)
+bool rg_pager_read(rg_pager_t *pager, size_t address, void *buffer, size_t size);
+rg_pager_counters_t rg_pager_get_counters(void);
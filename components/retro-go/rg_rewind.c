@@ -0,0 +1,294 @@
+#include "rg_system.h"
+#include "rg_rewind.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef RG_REWIND_KEY
+#define RG_REWIND_KEY RG_KEY_L
+#endif
+
+// Index of the deltas in the ring, oldest first
+#define MAX_ENTRIES (1024)
+// States bigger than this are not supported
+#define MAX_STATE_SIZE (1024 * 1024)
+
+typedef struct
+{
+    uint32_t offset;
+    uint32_t size;
+    bool base; // Encoded against nothing, it can't be undone
+} entry_t;
+
+static struct
+{
+    uint8_t *buffer; // Encoded deltas
+    size_t capacity;
+    size_t head;     // Where the next delta goes
+    entry_t entries[MAX_ENTRIES];
+    int first, count;
+    uint8_t *current; // Latest captured (or restored) state, deltas are applied to it
+    uint8_t *scratch;
+    size_t state_capacity;
+    size_t state_size;
+    int interval;
+    int ticks; // Since the last capture
+    bool enabled;
+} history;
+static rg_rewind_counters_t counters;
+
+
+// Format is a sequence of: [u16 unchanged bytes][u16 changed bytes][changed bytes XOR previous]
+// A change run only ends on 4 unchanged bytes or more, so the output is at most a few bytes larger
+// than the input no matter what.
+static size_t delta_encode(uint8_t *out, const uint8_t *state, const uint8_t *prev, size_t size)
+{
+    size_t pos = 0, i = 0;
+
+    while (i < size)
+    {
+        size_t skip = 0, literals = 0;
+
+        while (i < size && skip < 0xFFFF && state[i] == prev[i])
+            skip++, i++;
+
+        while (i + literals < size && literals < 0xFFFF)
+        {
+            size_t j = i + literals;
+            if (state[j] == prev[j] && (j + 4 > size || (state[j + 1] == prev[j + 1] && state[j + 2] == prev[j + 2]
+                                                         && state[j + 3] == prev[j + 3])))
+                break;
+            literals++;
+        }
+
+        uint16_t header[2] = {skip, literals};
+        memcpy(out + pos, header, 4);
+        pos += 4;
+        for (size_t k = 0; k < literals; ++k)
+            out[pos + k] = state[i + k] ^ prev[i + k];
+        pos += literals;
+        i += literals;
+    }
+
+    return pos;
+}
+
+static void delta_apply(uint8_t *state, const uint8_t *in, size_t size)
+{
+    size_t pos = 0, i = 0;
+
+    while (pos < size)
+    {
+        uint16_t header[2];
+        memcpy(header, in + pos, 4);
+        pos += 4;
+        i += header[0];
+        for (size_t k = 0; k < header[1]; ++k)
+            state[i + k] ^= in[pos + k];
+        pos += header[1];
+        i += header[1];
+    }
+}
+
+static inline entry_t *entry(int index)
+{
+    return &history.entries[(history.first + index) % MAX_ENTRIES];
+}
+
+static void drop_oldest(void)
+{
+    history.first = (history.first + 1) % MAX_ENTRIES;
+    history.count--;
+}
+
+static bool serialize(void)
+{
+    const rg_app_t *app = rg_system_get_app();
+
+    while (1)
+    {
+        size_t size = history.state_capacity;
+        if (app->handlers.saveStateMem(history.scratch, &size))
+        {
+            history.state_size = size;
+            return true;
+        }
+        // The handler tells us how much it needs if it knows, otherwise we guess
+        size = RG_MAX(size, RG_MAX(history.state_capacity * 2, 4096));
+        if (size > MAX_STATE_SIZE)
+            return false;
+        free(history.current);
+        free(history.scratch);
+        history.current = rg_alloc(size, MEM_SLOW | MEM_NOPANIC);
+        history.scratch = rg_alloc(size, MEM_SLOW | MEM_NOPANIC);
+        history.state_capacity = size;
+        if (!history.current || !history.scratch)
+            return false;
+        history.count = 0; // The history is tied to the current buffer
+    }
+}
+
+static bool capture(void)
+{
+    const int64_t time_start = rg_system_timer();
+    size_t prev_size = history.state_size;
+
+    if (!serialize())
+    {
+        RG_LOGE("Failed to serialize state, rewind disabled.\n");
+        rg_rewind_deinit();
+        return false;
+    }
+
+    // A state that changes size can't be diffed, start a new history
+    bool base = history.count == 0 || history.state_size != prev_size;
+    if (base)
+    {
+        history.count = 0;
+        memset(history.current, 0, history.state_size);
+    }
+
+    size_t needed = history.state_size + 4 * (history.state_size / 0xFFFF + 2);
+    if (needed > history.capacity)
+    {
+        RG_LOGE("State doesn't fit in the history, rewind disabled.\n");
+        rg_rewind_deinit();
+        return false;
+    }
+
+    // Make room, the ring is filled in address order so the oldest deltas are right after head
+    if (history.head + needed > history.capacity)
+    {
+        while (history.count > 0 && entry(0)->offset >= history.head)
+            drop_oldest();
+        history.head = 0;
+    }
+    while (history.count > 0 && entry(0)->offset < history.head + needed && entry(0)->offset >= history.head)
+        drop_oldest();
+    if (history.count == MAX_ENTRIES)
+        drop_oldest();
+    // We lost the base but that's fine, undoing the oldest delta still gives a valid state
+
+    size_t size = delta_encode(history.buffer + history.head, history.scratch, history.current, history.state_size);
+    *entry(history.count++) = (entry_t){history.head, size, base};
+    history.head += size;
+
+    // What we just captured becomes the reference for the next one
+    uint8_t *temp = history.current;
+    history.current = history.scratch;
+    history.scratch = temp;
+    history.ticks = 0;
+
+    counters.captures++;
+    counters.captureTime += rg_system_timer() - time_start;
+    counters.rawBytes += history.state_size;
+    counters.storedBytes += size;
+
+    return true;
+}
+
+bool rg_rewind_step_back(void)
+{
+    const rg_app_t *app = rg_system_get_app();
+
+    if (!history.enabled || history.count == 0)
+        return false;
+
+    // Go back to the last capture first, then one delta at a time
+    if (history.ticks == 0)
+    {
+        entry_t *newest = entry(history.count - 1);
+        if (newest->base)
+            return false;
+        delta_apply(history.current, history.buffer + newest->offset, newest->size);
+        history.head = newest->offset;
+        history.count--;
+    }
+
+    history.ticks = 0;
+    counters.rewinds++;
+
+    if (!app->handlers.loadStateMem(history.current, history.state_size))
+    {
+        RG_LOGE("Failed to restore state!\n");
+        rg_rewind_reset();
+        return false;
+    }
+
+    return true;
+}
+
+void rg_rewind_tick(void)
+{
+    if (!history.enabled)
+        return;
+
+    if (rg_input_key_is_pressed(RG_REWIND_KEY))
+    {
+        rg_rewind_step_back();
+        return;
+    }
+
+    if (++history.ticks >= history.interval || history.count == 0)
+        capture();
+}
+
+void rg_rewind_reset(void)
+{
+    // After a state load or a reset the history no longer leads to the current state
+    history.count = 0;
+    history.head = 0;
+    history.ticks = 0;
+}
+
+bool rg_rewind_enabled(void)
+{
+    return history.enabled;
+}
+
+rg_rewind_counters_t rg_rewind_get_counters(void)
+{
+    counters.entries = history.count;
+    counters.historyTicks = history.count * history.interval + history.ticks;
+    counters.historyBytes = 0;
+    for (int i = 0; i < history.count; ++i)
+        counters.historyBytes += entry(i)->size;
+    return counters;
+}
+
+bool rg_rewind_init(size_t historySize, int interval)
+{
+    const rg_app_t *app = rg_system_get_app();
+
+    rg_rewind_deinit();
+
+    if (!app->handlers.saveStateMem || !app->handlers.loadStateMem)
+    {
+        RG_LOGW("This core doesn't support memory states, rewind unavailable.\n");
+        return false;
+    }
+
+    if (!(history.buffer = rg_alloc(historySize, MEM_SLOW | MEM_NOPANIC)))
+        return false;
+    history.capacity = historySize;
+    history.interval = RG_MAX(interval, 1);
+    history.state_capacity = 0;
+    history.state_size = 0;
+    rg_rewind_reset();
+    memset(&counters, 0, sizeof(counters));
+    history.enabled = true;
+
+    RG_LOGI("Rewind enabled: %dKB history, snapshot every %d frames.\n", (int)(historySize / 1024), history.interval);
+    return true;
+}
+
+void rg_rewind_deinit(void)
+{
+    history.enabled = false;
+    free(history.buffer);
+    free(history.current);
+    free(history.scratch);
+    history.buffer = history.current = history.scratch = NULL;
+    history.state_capacity = 0;
+    rg_rewind_reset();
+}
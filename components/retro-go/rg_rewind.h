@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Rewind keeps a history of the emulator's state in RAM. Every `interval` frames the core serializes
+// itself through its saveStateMem handler, the state is XOR'd with the previous one and the (mostly
+// zero) result is run-length encoded into a fixed-size ring. Stepping back undoes one delta at a time.
+typedef struct
+{
+    int32_t captures;     // Snapshots taken
+    int64_t captureTime;  // Time spent taking them (serialization + delta + encoding)
+    int64_t rawBytes;     // Size of the states
+    int64_t storedBytes;  // Size of the encoded deltas
+    int32_t entries;      // Snapshots currently in the history
+    int32_t historyTicks; // Frames of history currently available
+    int32_t historyBytes; // Memory used by them
+    int32_t rewinds;      // Steps back
+} rg_rewind_counters_t;
+
+bool rg_rewind_init(size_t historySize, int interval);
+void rg_rewind_deinit(void);
+bool rg_rewind_enabled(void);
+void rg_rewind_tick(void);
+bool rg_rewind_step_back(void);
+void rg_rewind_reset(void);
+rg_rewind_counters_t rg_rewind_get_counters(void);
@@ -0,0 +1,443 @@
+#include "rg_system.h"
+#include "rg_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DELTA_MAGIC   (0x44534752) // "RGSD"
+#define DELTA_VERSION (1)
+#define PAGE_SIZE     (512)
+// After this many deltas on the same base we write the full state again
+#define MAX_DELTAS    (16)
+// States bigger than this are not supported
+#define MAX_STATE_SIZE (1024 * 1024)
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t page_size;
+    uint32_t state_size;
+    uint32_t base_crc;   // Of the full state file this delta applies to
+    uint32_t pages;      // Pages that follow the bitmap
+    uint32_t generation; // Deltas written since the base
+} delta_header_t;
+
+static struct
+{
+    char path[RG_PATH_MAX]; // State file the base belongs to
+    uint8_t *base;          // Content of that file
+    size_t base_size;
+    size_t base_capacity;
+    uint32_t base_crc;
+    int deltas;
+    uint8_t *buffer; // Current state
+    size_t capacity;
+} cache;
+static struct
+{
+    rg_queue_t *done;
+    char filename[RG_PATH_MAX];
+    char previewPath[RG_PATH_MAX];
+    rg_surface_t *preview;
+    size_t size;
+    size_t written;
+    bool full;
+    int64_t startTime, endTime;
+    int resumeTime;
+    rg_state_callback_t callback;
+    void *arg;
+    bool busy; // Only accessed by the emulation thread, the queues do the signaling
+} writer;
+static rg_state_counters_t counters;
+
+
+static bool reserve(uint8_t **buffer, size_t *capacity, size_t size)
+{
+    if (size <= *capacity)
+        return true;
+    free(*buffer);
+    *buffer = size <= MAX_STATE_SIZE ? rg_alloc(size, MEM_SLOW | MEM_NOPANIC) : NULL;
+    *capacity = *buffer ? size : 0;
+    return *buffer != NULL;
+}
+
+static bool serialize(size_t *out_size)
+{
+    const rg_app_t *app = rg_system_get_app();
+    size_t size = cache.capacity;
+
+    if (!app->handlers.saveStateMem)
+        return false;
+
+    while (!app->handlers.saveStateMem(cache.buffer, &size))
+    {
+        // The handler tells us how much it needs if it knows, otherwise we guess
+        size = RG_MAX(size, RG_MAX(cache.capacity * 2, 4096));
+        if (!reserve(&cache.buffer, &cache.capacity, size))
+            return false;
+        size = cache.capacity;
+    }
+
+    *out_size = size;
+    return true;
+}
+
+static void set_base(const char *filename, size_t size)
+{
+    // The state we just wrote (or read) becomes the reference for the next deltas
+    uint8_t *temp = cache.base;
+    size_t capacity = cache.base_capacity;
+    cache.base = cache.buffer;
+    cache.base_capacity = cache.capacity;
+    cache.buffer = temp;
+    cache.capacity = capacity;
+    cache.base_size = size;
+    cache.base_crc = rg_crc32(0, cache.base, size);
+    cache.deltas = 0;
+    snprintf(cache.path, sizeof(cache.path), "%s", filename);
+}
+
+static size_t write_delta(FILE *fp, const uint8_t *state, size_t size)
+{
+    size_t bitmap_size = ((size + PAGE_SIZE - 1) / PAGE_SIZE + 7) / 8;
+    uint8_t bitmap[bitmap_size];
+    size_t written = 0;
+
+    delta_header_t header = {
+        .magic = DELTA_MAGIC,
+        .version = DELTA_VERSION,
+        .page_size = PAGE_SIZE,
+        .state_size = size,
+        .base_crc = cache.base_crc,
+        .generation = cache.deltas + 1,
+    };
+
+    memset(bitmap, 0, bitmap_size);
+    for (size_t offset = 0, page = 0; offset < size; offset += PAGE_SIZE, page++)
+    {
+        if (memcmp(state + offset, cache.base + offset, RG_MIN(PAGE_SIZE, size - offset)) != 0)
+        {
+            bitmap[page / 8] |= 1 << (page % 8);
+            header.pages++;
+        }
+    }
+
+    // Past that point a full save is about as fast and keeps the next deltas small
+    if (header.pages * PAGE_SIZE > size / 2)
+        return 0;
+
+    size_t expected = sizeof(header) + bitmap_size;
+    written += fwrite(&header, sizeof(header), 1, fp) * sizeof(header);
+    written += fwrite(bitmap, bitmap_size, 1, fp) * bitmap_size;
+    for (size_t offset = 0, page = 0; offset < size; offset += PAGE_SIZE, page++)
+    {
+        if (bitmap[page / 8] & (1 << (page % 8)))
+        {
+            size_t len = RG_MIN(PAGE_SIZE, size - offset);
+            written += fwrite(state + offset, len, 1, fp) * len;
+            expected += len;
+        }
+    }
+
+    if (written != expected)
+        return 0;
+
+    return written;
+}
+
+static bool apply_delta(FILE *fp, uint8_t *state, size_t size, uint32_t base_crc, int *generation)
+{
+    delta_header_t header;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != DELTA_MAGIC)
+        return false;
+
+    if (header.version != DELTA_VERSION || header.page_size != PAGE_SIZE || header.state_size != size)
+        return false;
+
+    if (header.base_crc != base_crc)
+    {
+        RG_LOGW("Delta doesn't match the state file, ignoring it.\n");
+        return false;
+    }
+
+    size_t bitmap_size = ((size + PAGE_SIZE - 1) / PAGE_SIZE + 7) / 8;
+    uint8_t bitmap[bitmap_size];
+
+    if (fread(bitmap, bitmap_size, 1, fp) != 1)
+        return false;
+
+    for (size_t offset = 0, page = 0; offset < size; offset += PAGE_SIZE, page++)
+    {
+        if (bitmap[page / 8] & (1 << (page % 8)))
+        {
+            if (fread(state + offset, RG_MIN(PAGE_SIZE, size - offset), 1, fp) != 1)
+                return false;
+        }
+    }
+
+    *generation = header.generation;
+    return true;
+}
+
+// Writes the state in cache.buffer, returns the number of bytes written or 0 on failure
+static size_t write_state(const char *filename, size_t size, bool *full)
+{
+    char tempname[RG_PATH_MAX + 16], deltaname[RG_PATH_MAX + 16];
+    size_t written = 0;
+    FILE *fp;
+
+    #define tempname(ext) strcat(strcpy(tempname, filename), ext)
+    snprintf(deltaname, sizeof(deltaname), "%s.delta", filename);
+
+    *full = false;
+
+    if (cache.base && cache.base_size == size && cache.deltas < MAX_DELTAS && strcmp(cache.path, filename) == 0)
+    {
+        if ((fp = fopen(tempname(".delta.new"), "wb")))
+        {
+            written = write_delta(fp, cache.buffer, size);
+            if (fclose(fp) != 0)
+                written = 0;
+            if (written)
+            {
+                // FatFS can't rename over an existing file, a crash in between only loses the delta
+                remove(deltaname);
+                if (rename(tempname(".delta.new"), deltaname) == 0)
+                {
+                    RG_LOGI("Wrote delta %d: %dKB of %dKB.\n", cache.deltas + 1, (int)(written / 1024),
+                            (int)(size / 1024));
+                    cache.deltas++;
+                    remove(tempname(".delta.new"));
+                    return written;
+                }
+            }
+            remove(tempname(".delta.new"));
+        }
+    }
+
+    if ((fp = fopen(tempname(".new"), "wb")))
+    {
+        written = fwrite(cache.buffer, size, 1, fp) * size;
+        if (fclose(fp) == 0 && written == size)
+        {
+            rename(filename, tempname(".bak"));
+            if (rename(tempname(".new"), filename) == 0)
+            {
+                // The delta, if any, was against the old base
+                remove(deltaname);
+                remove(tempname(".bak"));
+                set_base(filename, size);
+                *full = true;
+                return written;
+            }
+            rename(tempname(".bak"), filename);
+        }
+        remove(tempname(".new"));
+    }
+
+    #undef tempname
+
+    return 0;
+}
+
+static void record_save(size_t size, size_t written, bool full, int saveTime, int resumeTime)
+{
+    counters.saves++;
+    counters.fullSaves += full;
+    counters.saveTime += saveTime;
+    counters.maxSaveTime = RG_MAX(counters.maxSaveTime, saveTime);
+    counters.resumeTime += resumeTime;
+    counters.maxResumeTime = RG_MAX(counters.maxResumeTime, resumeTime);
+    counters.bytesWritten += written;
+    counters.stateBytes += size;
+}
+
+// One task per save: saves are rare and task slots are few, so the slot is only held while writing
+static void writer_task(void *arg)
+{
+    writer.written = write_state(writer.filename, writer.size, &writer.full);
+
+    // The screenshot is only there to illustrate the state, it's not worth failing the save for it
+    if (writer.preview && writer.written && !rg_surface_save_image_file(writer.preview, writer.previewPath, 0, 0))
+        RG_LOGW("Failed to save the preview '%s'.\n", writer.previewPath);
+    rg_surface_free(writer.preview);
+    writer.preview = NULL;
+    writer.endTime = rg_system_timer();
+
+    rg_queue_send(writer.done, NULL, -1);
+}
+
+static void writer_finish(void)
+{
+    writer.busy = false;
+
+    if (writer.written)
+    {
+        int saveTime = writer.endTime - writer.startTime;
+        record_save(writer.size, writer.written, writer.full, saveTime, writer.resumeTime);
+        RG_LOGI("Saved '%s' in %dms (resumed after %dms).\n", writer.filename, saveTime / 1000,
+                writer.resumeTime / 1000);
+    }
+    else
+    {
+        RG_LOGE("Failed to write '%s'!\n", writer.filename);
+        rg_state_forget();
+    }
+
+    if (writer.callback)
+        writer.callback(writer.filename, writer.written != 0, writer.arg);
+}
+
+void rg_state_poll(void)
+{
+    if (writer.busy && rg_queue_receive(writer.done, NULL, 0))
+        writer_finish();
+}
+
+void rg_state_wait(void)
+{
+    if (writer.busy && rg_queue_receive(writer.done, NULL, -1))
+        writer_finish();
+}
+
+bool rg_state_busy(void)
+{
+    return writer.busy;
+}
+
+bool rg_state_save_async(const char *filename, rg_surface_t *preview, const char *previewPath,
+                         rg_state_callback_t callback, void *arg)
+{
+    const int64_t time_start = rg_system_timer();
+    size_t size = 0;
+
+    // The buffers are shared with the writer, only one save at a time
+    rg_state_wait();
+
+    if (!writer.done)
+        writer.done = rg_queue_create(1, 0);
+
+    if (!serialize(&size))
+    {
+        RG_LOGE("Failed to serialize state!\n");
+        rg_surface_free(preview);
+        rg_state_forget();
+        return false;
+    }
+
+    snprintf(writer.filename, sizeof(writer.filename), "%s", filename);
+    snprintf(writer.previewPath, sizeof(writer.previewPath), "%s", previewPath ?: "");
+    writer.preview = previewPath ? preview : NULL;
+    writer.size = size;
+    writer.callback = callback;
+    writer.arg = arg;
+    writer.startTime = time_start;
+    writer.resumeTime = rg_system_timer() - time_start;
+
+    if (!rg_task_try_create("rg_state", &writer_task, NULL, 6 * 1024, RG_TASK_PRIORITY_2, -1))
+    {
+        RG_LOGE("Failed to start the state writer!\n");
+        rg_surface_free(preview);
+        writer.preview = NULL;
+        rg_state_forget();
+        return false;
+    }
+
+    writer.busy = true;
+    return true;
+}
+
+bool rg_state_save(const char *filename)
+{
+    const int64_t time_start = rg_system_timer();
+    size_t size = 0, written;
+    bool full;
+
+    rg_state_wait();
+
+    if (!serialize(&size))
+    {
+        RG_LOGE("Failed to serialize state!\n");
+        return false;
+    }
+
+    if (!(written = write_state(filename, size, &full)))
+    {
+        rg_state_forget();
+        return false;
+    }
+
+    int elapsed = rg_system_timer() - time_start;
+    record_save(size, written, full, elapsed, elapsed);
+
+    return true;
+}
+
+bool rg_state_load(const char *filename)
+{
+    const rg_app_t *app = rg_system_get_app();
+    char tempname[RG_PATH_MAX + 16];
+    int generation = 0;
+    size_t size;
+    FILE *fp;
+
+    rg_state_wait();
+
+    if (!app->handlers.loadStateMem || !(fp = fopen(filename, "rb")))
+        return false;
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    bool success = reserve(&cache.buffer, &cache.capacity, size) && fread(cache.buffer, size, 1, fp) == 1;
+    fclose(fp);
+
+    if (!success)
+    {
+        RG_LOGE("Failed to read '%s'!\n", filename);
+        rg_state_forget();
+        return false;
+    }
+
+    set_base(filename, size);
+
+    if ((fp = fopen(strcat(strcpy(tempname, filename), ".delta"), "rb")))
+    {
+        // The base stays untouched, the delta is applied to a copy
+        if (reserve(&cache.buffer, &cache.capacity, size))
+        {
+            memcpy(cache.buffer, cache.base, size);
+            if (apply_delta(fp, cache.buffer, size, cache.base_crc, &generation))
+                cache.deltas = generation;
+            else
+                RG_LOGW("Failed to apply '%s', loading the full state only.\n", tempname);
+        }
+        fclose(fp);
+    }
+
+    if (generation > 0)
+        success = app->handlers.loadStateMem(cache.buffer, size);
+    else
+        success = app->handlers.loadStateMem(cache.base, size);
+
+    if (!success)
+        rg_state_forget();
+
+    return success;
+}
+
+void rg_state_forget(void)
+{
+    rg_state_wait();
+    // Next save will be a full one
+    cache.path[0] = 0;
+    cache.deltas = 0;
+}
+
+rg_state_counters_t rg_state_get_counters(void)
+{
+    return counters;
+}
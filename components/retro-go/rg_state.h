@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rg_surface.h"
+
+// Save states for cores that implement saveStateMem/loadStateMem. The state file itself is unchanged (it's
+// what the core's serializer outputs) but once a slot has been saved or loaded, the following saves only
+// write the pages that differ from it to a "<state>.delta" file next to it. Every so often, or when the
+// delta becomes too large, the full state is written again.
+//
+// rg_state_save_async only serializes the state before returning, the files (and the optional preview PNG)
+// are written by a low priority task. The callback is called from rg_state_poll (rg_system_tick) or
+// rg_state_wait, on the emulation thread. All other rg_state functions wait for a pending save first.
+typedef struct
+{
+    int32_t saves;         // Total saves
+    int32_t fullSaves;     // Saves that wrote the full state
+    int64_t saveTime;      // From the call until the files are written (serialization + writes + preview)
+    int32_t maxSaveTime;   // Slowest save
+    int64_t resumeTime;    // From the call until the emulation can continue
+    int32_t maxResumeTime; // Longest pause
+    int64_t bytesWritten;  // Bytes written to storage
+    int64_t stateBytes;    // Size of the states saved
+} rg_state_counters_t;
+
+typedef void (*rg_state_callback_t)(const char *filename, bool success, void *arg);
+
+bool rg_state_save(const char *filename);
+// Takes ownership of preview, it's saved as a PNG to previewPath as is. If it fails the cache is forgotten.
+bool rg_state_save_async(const char *filename, rg_surface_t *preview, const char *previewPath,
+                         rg_state_callback_t callback, void *arg);
+bool rg_state_busy(void);
+void rg_state_poll(void);
+void rg_state_wait(void);
+bool rg_state_load(const char *filename);
+// Must be called when a state file is written by other means, so that no delta is made against a stale base
+void rg_state_forget(void);
+rg_state_counters_t rg_state_get_counters(void);
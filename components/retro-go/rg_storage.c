@@ -368,3 +368,807 @@ bool rg_storage_scandir(const char *path, rg_scandir_cb_t *callback, void *arg,
 
     return true;
 }
+
+FILE *rg_storage_open_mem(void *buffer, size_t size, const char *mode)
+{
+    if (!buffer || !size)
+        return NULL;
+#if defined(_WIN32) || defined(_WIN64)
+    RG_LOGE("Memory streams aren't supported on this platform.\n");
+    return NULL;
+#else
+    FILE *fp = fmemopen(buffer, size, mode);
+    if (!fp)
+        RG_LOGE("fmemopen failed: %s\n", strerror(errno));
+    return fp;
+#endif
+}
+
+size_t rg_storage_close_mem(FILE *fp)
+{
+    if (!fp)
+        return 0;
+    // The buffer doesn't grow, writing past its end is only reported when stdio flushes
+    long pos = ftell(fp);
+    bool error = fflush(fp) != 0 || ferror(fp) || pos < 0;
+    fclose(fp);
+    return error ? 0 : pos;
+}
+
+/**
+ * Compressed ROMs.
+ * The whole image is decompressed straight into the caller's buffer, which doubles as the LZ77 window.
+ * The compressed data is streamed through a small buffer so we never hold both images in memory.
+ */
+#define ROM_READ_BUFFER_SIZE (4096)
+#define ZIP_EOCD_SIZE        (22)
+#define ZIP_CDIR_SIZE        (46)
+#define ZIP_LOCAL_SIZE       (30)
+#define LZ4_FRAME_MAGIC      (0x184D2204)
+#define LZ4_LEGACY_MAGIC     (0x184C2102)
+#define LZ4_LEGACY_BLOCK     (8 * 1024 * 1024)
+
+typedef enum
+{
+    ROM_RAW = 0,
+    ROM_ZIP,
+    ROM_GZIP,
+    ROM_LZ4,
+} rom_format_t;
+
+struct rg_rom_file_s
+{
+    FILE *fp;
+    rom_format_t format;
+    int method;         // Zip: 0 stored, 8 deflate. LZ4: block checksum flag
+    bool lz4_legacy;
+    size_t size;        // Decompressed size
+    size_t packed_size; // Size of the compressed stream
+    long offset;        // Start of the compressed stream
+    uint32_t crc;       // Expected crc32 of the decompressed data, when the format has one
+    bool has_crc;
+    // Buffered input, in_left is what remains of the compressed stream
+    size_t in_left, in_pos, in_len;
+    uint8_t in_buf[ROM_READ_BUFFER_SIZE];
+};
+
+typedef struct
+{
+    short count[16];
+    short *symbol;
+} huffman_t;
+
+typedef struct
+{
+    rg_rom_file_t *rom;
+    uint32_t bitbuf;
+    int bitcnt;
+    bool error;
+    uint8_t *out;
+    size_t outcnt, outlen;
+    huffman_t lencode, distcode;
+    short lensym[288], distsym[30];
+} inflate_t;
+
+static int rom_getc(rg_rom_file_t *rom)
+{
+    if (rom->in_pos == rom->in_len)
+    {
+        size_t len = RG_MIN(rom->in_left, sizeof(rom->in_buf));
+        if (len == 0 || fread(rom->in_buf, len, 1, rom->fp) != 1)
+            return -1;
+        rom->in_left -= len;
+        rom->in_pos = 0;
+        rom->in_len = len;
+    }
+    return rom->in_buf[rom->in_pos++];
+}
+
+// dst can be NULL to skip data
+static bool rom_read(rg_rom_file_t *rom, uint8_t *dst, size_t len)
+{
+    size_t buffered = RG_MIN(len, rom->in_len - rom->in_pos);
+    if (dst)
+        memcpy(dst, rom->in_buf + rom->in_pos, buffered);
+    rom->in_pos += buffered;
+    len -= buffered;
+    if (len == 0)
+        return true;
+    if (len > rom->in_left)
+        return false;
+    rom->in_left -= len;
+    if (dst)
+        return fread(dst + buffered, len, 1, rom->fp) == 1;
+    return fseek(rom->fp, len, SEEK_CUR) == 0;
+}
+
+static uint32_t rom_get32(rg_rom_file_t *rom)
+{
+    uint8_t b[4] = {0};
+    rom_read(rom, b, 4);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static bool rom_seek(rg_rom_file_t *rom, long offset, size_t length)
+{
+    rom->in_pos = rom->in_len = 0;
+    rom->in_left = length;
+    return fseek(rom->fp, offset, SEEK_SET) == 0;
+}
+
+static inline uint32_t get16(const uint8_t *ptr)
+{
+    return ptr[0] | (ptr[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *ptr)
+{
+    return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+/* Inflate, based on Mark Adler's puff. It's not the fastest but it needs no memory beyond the window. */
+static const short lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const short lext[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const short dbase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const short dext[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static int inflate_bits(inflate_t *s, int need)
+{
+    uint32_t val = s->bitbuf;
+    while (s->bitcnt < need)
+    {
+        int byte = rom_getc(s->rom);
+        if (byte < 0)
+        {
+            s->error = true;
+            return 0;
+        }
+        val |= (uint32_t)byte << s->bitcnt;
+        s->bitcnt += 8;
+    }
+    s->bitbuf = val >> need;
+    s->bitcnt -= need;
+    return val & ((1L << need) - 1);
+}
+
+static int inflate_decode(inflate_t *s, const huffman_t *h)
+{
+    int code = 0, first = 0, index = 0, len = 1;
+    uint32_t bitbuf = s->bitbuf;
+    int left = s->bitcnt;
+
+    while (1)
+    {
+        while (left--)
+        {
+            code |= bitbuf & 1;
+            bitbuf >>= 1;
+            int count = h->count[len];
+            if (code - count < first)
+            {
+                s->bitbuf = bitbuf;
+                s->bitcnt = (s->bitcnt - len) & 7;
+                return h->symbol[index + (code - first)];
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+            len++;
+        }
+        left = 16 - len;
+        if (left == 0)
+            break;
+        int byte = rom_getc(s->rom);
+        if (byte < 0)
+        {
+            s->error = true;
+            return -1;
+        }
+        bitbuf = byte;
+        if (left > 8)
+            left = 8;
+    }
+
+    return -10; // Ran out of codes
+}
+
+// Returns 0 for a complete code, negative for an over-subscribed code, positive for an incomplete one
+static int inflate_construct(huffman_t *h, const short *length, int n)
+{
+    short offs[16];
+    int left = 1;
+
+    memset(h->count, 0, sizeof(h->count));
+    for (int symbol = 0; symbol < n; symbol++)
+        h->count[length[symbol]]++;
+    if (h->count[0] == n)
+        return 0;
+
+    for (int len = 1; len < 16; len++)
+    {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0)
+            return left;
+    }
+
+    offs[1] = 0;
+    for (int len = 1; len < 15; len++)
+        offs[len + 1] = offs[len] + h->count[len];
+    for (int symbol = 0; symbol < n; symbol++)
+        if (length[symbol] != 0)
+            h->symbol[offs[length[symbol]]++] = symbol;
+
+    return left;
+}
+
+static bool inflate_codes(inflate_t *s)
+{
+    while (!s->error)
+    {
+        int symbol = inflate_decode(s, &s->lencode);
+        if (symbol < 0)
+            return false;
+        if (symbol == 256)
+            return true;
+        if (symbol < 256)
+        {
+            if (s->outcnt == s->outlen)
+                return false;
+            s->out[s->outcnt++] = symbol;
+            continue;
+        }
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+        size_t len = lbase[symbol] + inflate_bits(s, lext[symbol]);
+        symbol = inflate_decode(s, &s->distcode);
+        if (symbol < 0 || symbol >= 30)
+            return false;
+        size_t dist = dbase[symbol] + inflate_bits(s, dext[symbol]);
+        if (dist > s->outcnt || len > s->outlen - s->outcnt)
+            return false;
+        for (uint8_t *out = s->out + s->outcnt, *end = out + len; out < end; out++)
+            *out = *(out - dist);
+        s->outcnt += len;
+    }
+    return false;
+}
+
+static bool inflate_stored(inflate_t *s)
+{
+    // Stored blocks start on a byte boundary, the leftover bits are padding
+    s->bitbuf = 0;
+    s->bitcnt = 0;
+
+    uint8_t header[4];
+    if (!rom_read(s->rom, header, 4) || get16(header) != (~get16(header + 2) & 0xFFFF))
+        return false;
+    size_t len = get16(header);
+    if (len > s->outlen - s->outcnt || !rom_read(s->rom, s->out + s->outcnt, len))
+        return false;
+    s->outcnt += len;
+    return true;
+}
+
+static bool inflate_fixed(inflate_t *s)
+{
+    short lengths[288];
+    int symbol = 0;
+
+    for (; symbol < 144; symbol++)
+        lengths[symbol] = 8;
+    for (; symbol < 256; symbol++)
+        lengths[symbol] = 9;
+    for (; symbol < 280; symbol++)
+        lengths[symbol] = 7;
+    for (; symbol < 288; symbol++)
+        lengths[symbol] = 8;
+    inflate_construct(&s->lencode, lengths, 288);
+
+    for (symbol = 0; symbol < 30; symbol++)
+        lengths[symbol] = 5;
+    inflate_construct(&s->distcode, lengths, 30);
+
+    return inflate_codes(s);
+}
+
+static bool inflate_dynamic(inflate_t *s)
+{
+    static const short order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    short lengths[320] = {0};
+    int nlen = inflate_bits(s, 5) + 257;
+    int ndist = inflate_bits(s, 5) + 1;
+    int ncode = inflate_bits(s, 4) + 4;
+    int index, err;
+
+    if (nlen > 286 || ndist > 30)
+        return false;
+
+    for (index = 0; index < ncode; index++)
+        lengths[order[index]] = inflate_bits(s, 3);
+    if (inflate_construct(&s->lencode, lengths, 19) != 0)
+        return false;
+
+    for (index = 0; index < nlen + ndist && !s->error;)
+    {
+        int symbol = inflate_decode(s, &s->lencode);
+        if (symbol < 0)
+            return false;
+        if (symbol < 16)
+        {
+            lengths[index++] = symbol;
+            continue;
+        }
+        int len = 0, repeat;
+        if (symbol == 16)
+        {
+            if (index == 0)
+                return false;
+            len = lengths[index - 1];
+            repeat = 3 + inflate_bits(s, 2);
+        }
+        else if (symbol == 17)
+            repeat = 3 + inflate_bits(s, 3);
+        else
+            repeat = 11 + inflate_bits(s, 7);
+        if (index + repeat > nlen + ndist)
+            return false;
+        while (repeat--)
+            lengths[index++] = len;
+    }
+
+    if (s->error || lengths[256] == 0)
+        return false;
+
+    // Incomplete codes are only allowed if they have a single symbol
+    err = inflate_construct(&s->lencode, lengths, nlen);
+    if (err < 0 || (err > 0 && nlen - s->lencode.count[0] != 1))
+        return false;
+    err = inflate_construct(&s->distcode, lengths + nlen, ndist);
+    if (err < 0 || (err > 0 && ndist - s->distcode.count[0] != 1))
+        return false;
+
+    return inflate_codes(s);
+}
+
+static bool rom_inflate(rg_rom_file_t *rom, uint8_t *out, size_t outlen)
+{
+    inflate_t *s = rg_alloc(sizeof(inflate_t), MEM_ANY | MEM_NOPANIC);
+    bool success = s != NULL;
+    int last = 0;
+
+    if (s)
+    {
+        *s = (inflate_t){.rom = rom, .out = out, .outlen = outlen};
+        s->lencode.symbol = s->lensym;
+        s->distcode.symbol = s->distsym;
+    }
+
+    while (success && !last)
+    {
+        last = inflate_bits(s, 1);
+        int type = inflate_bits(s, 2);
+        if (type == 0)
+            success = inflate_stored(s);
+        else if (type == 1)
+            success = inflate_fixed(s);
+        else if (type == 2)
+            success = inflate_dynamic(s);
+        else
+            success = false;
+        success = success && !s->error;
+    }
+
+    success = success && s->outcnt == outlen;
+    free(s);
+    return success;
+}
+
+/* LZ4 blocks, decoded straight from the input stream. With out == NULL we only measure the output. */
+static bool lz4_decode_block(rg_rom_file_t *rom, size_t block_size, uint8_t *out, size_t *outcnt, size_t outlen)
+{
+    size_t left = block_size;
+    size_t op = *outcnt;
+
+#define LZ4_GETC(var)                                 \
+    if (left-- == 0 || (var = rom_getc(rom)) < 0) \
+        return false;
+
+    while (left > 0)
+    {
+        int token, byte;
+        LZ4_GETC(token);
+        size_t literals = token >> 4;
+        size_t length = (token & 0xF) + 4;
+
+        if (literals == 15)
+        {
+            do
+            {
+                LZ4_GETC(byte);
+                literals += byte;
+            } while (byte == 255);
+        }
+
+        if (literals > left || (out && literals > outlen - op))
+            return false;
+        if (!rom_read(rom, out ? out + op : NULL, literals))
+            return false;
+        left -= literals;
+        op += literals;
+
+        // The last sequence has no match
+        if (left == 0)
+            break;
+
+        int lo, hi;
+        LZ4_GETC(lo);
+        LZ4_GETC(hi);
+        size_t offset = lo | (hi << 8);
+        if (offset == 0 || offset > op)
+            return false;
+
+        if ((token & 0xF) == 15)
+        {
+            do
+            {
+                LZ4_GETC(byte);
+                length += byte;
+            } while (byte == 255);
+        }
+
+        if (out)
+        {
+            if (length > outlen - op)
+                return false;
+            // Overlapping copies are how runs are encoded, memcpy/memmove won't do
+            for (uint8_t *ptr = out + op, *end = ptr + length; ptr < end; ptr++)
+                *ptr = *(ptr - offset);
+        }
+        op += length;
+    }
+
+#undef LZ4_GETC
+
+    *outcnt = op;
+    return true;
+}
+
+static bool rom_unlz4(rg_rom_file_t *rom, uint8_t *out, size_t *outcnt, size_t outlen)
+{
+    size_t op = 0;
+
+    rom_seek(rom, rom->offset, rom->packed_size);
+
+    while (rom->in_left > 0 || rom->in_pos < rom->in_len)
+    {
+        uint32_t block_size = rom_get32(rom);
+        if (rom->lz4_legacy)
+        {
+            // Legacy files can be concatenated frames
+            if (block_size == LZ4_LEGACY_MAGIC)
+                continue;
+            if (block_size > LZ4_LEGACY_BLOCK)
+                return false;
+        }
+        else if (block_size == 0)
+            break; // End mark, we don't check the content checksum
+        else if (block_size & 0x80000000)
+        {
+            // Uncompressed block
+            block_size &= 0x7FFFFFFF;
+            if (out && block_size > outlen - op)
+                return false;
+            if (!rom_read(rom, out ? out + op : NULL, block_size))
+                return false;
+            op += block_size;
+            if (rom->method)
+                rom_read(rom, NULL, 4);
+            continue;
+        }
+
+        if (!lz4_decode_block(rom, block_size, out, &op, outlen))
+            return false;
+        if (rom->method)
+            rom_read(rom, NULL, 4);
+    }
+
+    *outcnt = op;
+    return true;
+}
+
+static bool open_zip(rg_rom_file_t *rom, size_t file_size)
+{
+    size_t tail_size = RG_MIN(file_size, ZIP_EOCD_SIZE + 0xFFFF);
+    uint8_t *tail = rg_alloc(tail_size, MEM_SLOW | MEM_NOPANIC);
+    const uint8_t *eocd = NULL;
+
+    if (!tail)
+        return false;
+
+    // The end of central directory record is followed by a comment of up to 64KB
+    if (fseek(rom->fp, file_size - tail_size, SEEK_SET) == 0 && fread(tail, tail_size, 1, rom->fp) == 1)
+    {
+        for (long pos = tail_size - ZIP_EOCD_SIZE; pos >= 0 && !eocd; pos--)
+            if (get32(tail + pos) == 0x06054B50)
+                eocd = tail + pos;
+    }
+
+    uint32_t entries = eocd ? get16(eocd + 10) : 0;
+    uint32_t cdir_size = eocd ? get32(eocd + 12) : 0;
+    uint32_t cdir_offset = eocd ? get32(eocd + 16) : 0;
+    free(tail);
+
+    if (!eocd || cdir_offset == 0xFFFFFFFF || entries == 0xFFFF)
+    {
+        RG_LOGE("Zip central directory not found (or zip64)\n");
+        return false;
+    }
+
+    // Archives sometimes carry a readme or a nfo, the largest file is our best guess for the ROM
+    uint32_t local_offset = 0;
+    bool found = false;
+    rom_seek(rom, cdir_offset, cdir_size);
+    while (entries--)
+    {
+        uint8_t entry[ZIP_CDIR_SIZE];
+        char name[RG_PATH_MAX + 1] = {0};
+        if (!rom_read(rom, entry, ZIP_CDIR_SIZE) || get32(entry) != 0x02014B50)
+            break;
+        size_t name_len = get16(entry + 28);
+        size_t skip = get16(entry + 30) + get16(entry + 32);
+        if (name_len > RG_PATH_MAX || !rom_read(rom, (uint8_t *)name, name_len) || !rom_read(rom, NULL, skip))
+            break;
+        if (name_len == 0 || name[name_len - 1] == '/' || strncmp(name, "__MACOSX/", 9) == 0)
+            continue;
+        if (get32(entry + 24) > rom->size || !found)
+        {
+            if (get16(entry + 8) & 1)
+            {
+                RG_LOGW("Skipping encrypted file '%s'\n", name);
+                continue;
+            }
+            rom->method = get16(entry + 10);
+            rom->crc = get32(entry + 16);
+            rom->packed_size = get32(entry + 20);
+            rom->size = get32(entry + 24);
+            local_offset = get32(entry + 42);
+            found = true;
+            RG_LOGI("Found '%s' (method %d, %u bytes)\n", name, rom->method, (unsigned)rom->size);
+        }
+    }
+
+    if (!found)
+    {
+        RG_LOGE("No usable file in the archive\n");
+        return false;
+    }
+
+    if (rom->method != 0 && rom->method != 8)
+    {
+        RG_LOGE("Zip compression method %d isn't supported\n", rom->method);
+        return false;
+    }
+
+    uint8_t header[ZIP_LOCAL_SIZE];
+    rom_seek(rom, local_offset, ZIP_LOCAL_SIZE);
+    if (!rom_read(rom, header, ZIP_LOCAL_SIZE) || get32(header) != 0x04034B50)
+        return false;
+
+    rom->offset = local_offset + ZIP_LOCAL_SIZE + get16(header + 26) + get16(header + 28);
+    rom->has_crc = true;
+    return true;
+}
+
+static bool open_gzip(rg_rom_file_t *rom, size_t file_size)
+{
+    uint8_t header[10];
+
+    rom_seek(rom, 0, file_size - 8);
+    if (file_size < 18 || !rom_read(rom, header, 10) || header[2] != 8)
+        return false;
+
+    int flags = header[3];
+    if (flags & 0x04) // FEXTRA
+    {
+        uint8_t len[2];
+        rom_read(rom, len, 2);
+        rom_read(rom, NULL, get16(len));
+    }
+    if (flags & 0x08) // FNAME
+        while (rom_getc(rom) > 0)
+            continue;
+    if (flags & 0x10) // FCOMMENT
+        while (rom_getc(rom) > 0)
+            continue;
+    if (flags & 0x02) // FHCRC
+        rom_read(rom, NULL, 2);
+
+    rom->offset = ftell(rom->fp) - (rom->in_len - rom->in_pos);
+    rom->packed_size = file_size - 8 - rom->offset;
+
+    // The trailer has the crc and the size modulo 4GB, which is fine for us
+    rom_seek(rom, file_size - 8, 8);
+    rom->crc = rom_get32(rom);
+    rom->size = rom_get32(rom);
+    rom->method = 8;
+    rom->has_crc = true;
+    return true;
+}
+
+static bool open_lz4(rg_rom_file_t *rom, size_t file_size)
+{
+    rom_seek(rom, 0, file_size);
+
+    uint32_t magic = rom_get32(rom);
+    if (magic == LZ4_LEGACY_MAGIC)
+    {
+        rom->lz4_legacy = true;
+    }
+    else if (magic == LZ4_FRAME_MAGIC)
+    {
+        int flags = rom_getc(rom);
+        rom_getc(rom); // Block max size, we decode straight to the output so it doesn't matter
+        if ((flags & 0xC0) != 0x40 || (flags & 0x01))
+        {
+            RG_LOGE("Unsupported LZ4 frame flags: 0x%02X\n", flags);
+            return false;
+        }
+        if (flags & 0x08)
+        {
+            rom->size = rom_get32(rom);
+            if (rom_get32(rom) != 0)
+                return false;
+        }
+        rom_getc(rom); // Header checksum
+        rom->method = (flags & 0x10) ? 1 : 0;
+    }
+    else
+    {
+        return false;
+    }
+
+    rom->offset = ftell(rom->fp) - (rom->in_len - rom->in_pos);
+    rom->packed_size = file_size - rom->offset;
+
+    // Without a content size we have to go through the data once to know how much to allocate
+    if (rom->size == 0 && !rom_unlz4(rom, NULL, &rom->size, 0))
+        return false;
+
+    return true;
+}
+
+rg_rom_file_t *rg_storage_rom_open(const char *path)
+{
+    CHECK_PATH(path);
+
+    rg_rom_file_t *rom = calloc(1, sizeof(rg_rom_file_t));
+    if (!rom)
+        return NULL;
+
+    if (!(rom->fp = fopen(path, "rb")))
+    {
+        RG_LOGE("Failed to open '%s'\n", path);
+        free(rom);
+        return NULL;
+    }
+
+    fseek(rom->fp, 0, SEEK_END);
+    size_t file_size = ftell(rom->fp);
+    uint8_t magic[4] = {0};
+    fseek(rom->fp, 0, SEEK_SET);
+    fread(magic, 4, 1, rom->fp);
+
+    // The extension decides which decoder to try, the magic confirms it. That way a raw ROM that happens
+    // to start with the right bytes can't be mistaken for an archive.
+    const char *ext = rg_extension(path);
+    bool success = true;
+    if (strcasecmp(ext, "zip") == 0 && get32(magic) == 0x04034B50)
+        rom->format = ROM_ZIP, success = open_zip(rom, file_size);
+    else if (strcasecmp(ext, "gz") == 0 && magic[0] == 0x1F && magic[1] == 0x8B)
+        rom->format = ROM_GZIP, success = open_gzip(rom, file_size);
+    else if (strcasecmp(ext, "lz4") == 0 && (get32(magic) == LZ4_FRAME_MAGIC || get32(magic) == LZ4_LEGACY_MAGIC))
+        rom->format = ROM_LZ4, success = open_lz4(rom, file_size);
+    else
+        rom->size = rom->packed_size = file_size;
+
+    if (!success)
+    {
+        RG_LOGE("'%s' isn't a supported archive\n", path);
+        rg_storage_rom_close(rom);
+        return NULL;
+    }
+
+    return rom;
+}
+
+size_t rg_storage_rom_size(const rg_rom_file_t *rom)
+{
+    return rom ? rom->size : 0;
+}
+
+bool rg_storage_rom_compressed(const rg_rom_file_t *rom)
+{
+    return rom && rom->format != ROM_RAW;
+}
+
+bool rg_storage_rom_read(rg_rom_file_t *rom, void *buffer, size_t size)
+{
+    static const char *formats[] = {"raw", "zip", "gzip", "lz4"};
+    int64_t start_time = rg_system_timer();
+    size_t outcnt = 0;
+    bool success = false;
+
+    if (!rom || !buffer || size < rom->size)
+        return false;
+
+    rom_seek(rom, rom->offset, rom->packed_size);
+
+    if (rom->format == ROM_LZ4)
+        success = rom_unlz4(rom, buffer, &outcnt, rom->size) && outcnt == rom->size;
+    else if (rom->method == 8)
+        success = rom_inflate(rom, buffer, rom->size);
+    else
+        success = rom_read(rom, buffer, rom->size);
+
+    if (success && rom->has_crc && rg_crc32(0, buffer, rom->size) != rom->crc)
+    {
+        RG_LOGE("CRC mismatch, the archive is corrupted!\n");
+        success = false;
+    }
+
+    if (!success)
+    {
+        RG_LOGE("Failed to read the %s image!\n", formats[rom->format]);
+        return false;
+    }
+
+    // Peak memory is the destination buffer plus our reader and, for deflate, the decoder tables
+    size_t overhead = sizeof(rg_rom_file_t) + (rom->method == 8 ? sizeof(inflate_t) : 0);
+    RG_LOGI("Loaded %s image: %u => %u bytes in %dms, peak memory %u + %u bytes\n", formats[rom->format],
+            (unsigned)rom->packed_size, (unsigned)rom->size, (int)((rg_system_timer() - start_time) / 1000),
+            (unsigned)size, (unsigned)overhead);
+
+    return true;
+}
+
+void rg_storage_rom_close(rg_rom_file_t *rom)
+{
+    if (!rom)
+        return;
+    if (rom->fp)
+        fclose(rom->fp);
+    free(rom);
+}
+
+bool rg_storage_rom_load(const char *path, void **data_ptr, size_t *data_len)
+{
+    rg_rom_file_t *rom = rg_storage_rom_open(path);
+    void *data = NULL;
+
+    if (!rom || !data_ptr)
+    {
+        rg_storage_rom_close(rom);
+        return false;
+    }
+
+    size_t size = rg_storage_rom_size(rom);
+    if (!(data = rg_alloc(RG_MAX(size, 1), MEM_SLOW | MEM_NOPANIC)))
+        RG_LOGE("Not enough memory for a %u bytes ROM\n", (unsigned)size);
+    else if (!rg_storage_rom_read(rom, data, size))
+        free(data), data = NULL;
+
+    rg_storage_rom_close(rom);
+
+    if (!data)
+        return false;
+
+    *data_ptr = data;
+    if (data_len)
+        *data_len = size;
+    return true;
+}
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <time.h>
 
 #define RG_BASE_PATH        RG_STORAGE_ROOT "/retro-go"
@@ -68,3 +69,19 @@ bool rg_storage_exists(const char *path);
 bool rg_storage_mkdir(const char *dir);
 bool rg_storage_scandir(const char *path, rg_scandir_cb_t *callback, void *arg, uint32_t flags);
 rg_stat_t rg_storage_stat(const char *path);
+
+// Memory streams, so that the same FILE based serializer can target a file or a RAM buffer.
+// rg_storage_close_mem returns the position of the stream, or 0 if anything failed (eg buffer too small).
+FILE *rg_storage_open_mem(void *buffer, size_t size, const char *mode);
+size_t rg_storage_close_mem(FILE *fp);
+
+// ROM images, raw or compressed (.zip with stored/deflate entries, .gz, .lz4). The data is decompressed
+// as it is read from the disk, straight into the destination buffer. Use open/size/read when the core
+// needs a bigger or aligned buffer, or rg_storage_rom_load to get a rg_alloc'd buffer of the exact size.
+typedef struct rg_rom_file_s rg_rom_file_t;
+rg_rom_file_t *rg_storage_rom_open(const char *path);
+size_t rg_storage_rom_size(const rg_rom_file_t *file);
+bool rg_storage_rom_compressed(const rg_rom_file_t *file);
+bool rg_storage_rom_read(rg_rom_file_t *file, void *buffer, size_t size);
+void rg_storage_rom_close(rg_rom_file_t *file);
+bool rg_storage_rom_load(const char *path, void **data_ptr, size_t *data_len);
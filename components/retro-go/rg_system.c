@@ -1,4 +1,5 @@
 #include "rg_system.h"
+#include "rg_state.h"
 
 #include <sys/time.h>
 #include <stdarg.h>
@@ -37,8 +38,8 @@ typedef struct
 
 typedef struct
 {
-    int32_t totalFrames, fullFrames, partFrames, ticks;
-    int64_t busyTime, updateTime;
+    int32_t totalFrames, fullFrames, partFrames, ticks, runAheadTicks;
+    int64_t busyTime, updateTime, runAheadTime;
 } counters_t;
 
 typedef struct
@@ -75,6 +76,16 @@ static RTC_NOINIT_ATTR panic_trace_t panicTrace;
 static RTC_NOINIT_ATTR time_t rtcValue;
 static bool panicTraceCleared = false;
 static rg_stats_t statistics;
+static struct
+{
+    int frames;
+    void *buffer;
+    size_t capacity;
+    size_t size;
+    int64_t startTime;
+    int64_t totalTime;
+    int32_t ticks; // Frames that ran ahead
+} runAhead;
 static rg_app_t app;
 static rg_task_t tasks[8];
 
@@ -82,6 +93,10 @@ static const char *SETTING_BOOT_NAME = "BootName";
 static const char *SETTING_BOOT_ARGS = "BootArgs";
 static const char *SETTING_BOOT_FLAGS = "BootFlags";
 static const char *SETTING_TIMEZONE = "Timezone";
+static const char *SETTING_REWIND = "Rewind";
+
+#define REWIND_HISTORY_SIZE (1024 * 1024)
+#define REWIND_INTERVAL     (4)
 
 #define logbuf_putc(buf, c) (buf)->console[(buf)->cursor++] = c, (buf)->cursor %= RG_LOGBUF_SIZE;
 #define logbuf_puts(buf, str) for (const char *ptr = str; *ptr; ptr++) logbuf_putc(buf, *ptr);
@@ -139,6 +154,8 @@ static void update_statistics(void)
     counters.busyTime = statistics.busyTime;
     counters.ticks = statistics.ticks;
     counters.updateTime = statistics.lastTick;
+    counters.runAheadTicks = runAhead.ticks;
+    counters.runAheadTime = runAhead.totalTime;
 
     // We prefer to use the tick time for more accurate FPS
     // but if we're not ticking, we need to use current time
@@ -163,6 +180,12 @@ static void update_statistics(void)
         statistics.skippedFPS = (ticks - frames) / totalTimeSecs;
         statistics.fullFPS = fullFrames / totalTimeSecs;
         statistics.partialFPS = partFrames / totalTimeSecs;
+
+        // Frames that skipped run-ahead (frameskip, menus) don't get the latency reduction
+        float runAheadTicks = counters.runAheadTicks - previous.runAheadTicks;
+        statistics.runAheadFrames = runAhead.frames;
+        statistics.runAheadPercent = (counters.runAheadTime - previous.runAheadTime) / totalTime * 100.f;
+        statistics.runAheadLatency = ticks > 0 ? runAhead.frames * (runAheadTicks / ticks) * (totalTime / ticks) / 1000.f : 0;
     }
     statistics.uptime = rg_system_timer() / 1000000;
 
@@ -206,8 +229,8 @@ static void system_monitor_task(void *arg)
             (int)roundf(statistics.fullFPS),
             (int)roundf((battery.volts * 1000) ?: battery.level));
 
-        // Auto frameskip
-        if (statistics.ticks > app.tickRate * 2)
+        // Auto frameskip (not in headless mode, the output must only depend on the input)
+        if (statistics.ticks > app.tickRate * 2 && !rg_bench_get_config()->headless)
         {
             float speed = ((float)statistics.totalFPS / app.tickRate) * 100.f / app.speed;
             // We don't fully go back to 0 frameskip because if we dip below 95% once, we're clearly
@@ -230,10 +253,13 @@ static void system_monitor_task(void *arg)
             if (rg_input_wait_for_key(RG_KEY_MENU, true, 1000))
             {
                 const char *message = "App unresponsive... Hold MENU to quit!";
-                // Drawing at this point isn't safe. But the alternative is being frozen...
+                // The OSD is composited by the display task, we don't touch the LCD behind its back
+                rg_gui_set_osd(true);
                 rg_gui_draw_text(RG_GUI_CENTER, RG_GUI_CENTER, 0, message, C_RED, C_BLACK, RG_TEXT_BIGGER);
+                rg_gui_set_osd(false);
                 if (!rg_input_wait_for_key(RG_KEY_MENU, false, 2000))
                     RG_PANIC("Application terminated!"); // We're not in a nice state, don't normal exit
+                rg_display_osd_clear();
             }
         }
 
@@ -287,6 +313,12 @@ static void platform_init(void)
     // freopen("stdout.txt", "w", stdout);
     // freopen("stderr.txt", "w", stderr);
     SDL_SetMainReady();
+    if (rg_bench_get_config()->headless)
+    {
+        // Must be set before SDL_Init, it allows running without a display server or a sound card
+        setenv("SDL_VIDEODRIVER", "dummy", 0);
+        setenv("SDL_AUDIODRIVER", "dummy", 0);
+    }
     if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO) < 0)
         RG_PANIC("SDL Init failed!");
 #endif
@@ -302,6 +334,7 @@ rg_app_t *rg_system_reinit(int sampleRate, const rg_handlers_t *handlers, const
         app.handlers = *handlers;
     app.options = options;
     rg_audio_set_sample_rate(app.sampleRate);
+    rg_emu_set_rewind(rg_settings_get_number(NS_GLOBAL, SETTING_REWIND, 0));
 
     return &app;
 }
@@ -338,6 +371,7 @@ rg_app_t *rg_system_init(int sampleRate, const rg_handlers_t *handlers, const rg
     };
 
     // Do this very early, may be needed to enable serial console
+    rg_bench_init();
     platform_init();
     rg_system_set_led(0);
 
@@ -409,6 +443,15 @@ rg_app_t *rg_system_init(int sampleRate, const rg_handlers_t *handlers, const rg
     app.bootFlags = rg_settings_get_number(NS_BOOT, SETTING_BOOT_FLAGS, 0);
     app.saveSlot = (app.bootFlags & RG_BOOT_SLOT_MASK) >> 4;
     app.romPath = app.bootArgs;
+    if (rg_bench_get_config()->core)
+        app.configNs = rg_bench_get_config()->core;
+    if (rg_bench_get_config()->rom)
+    {
+        // Always a cold boot, a benchmark must not depend on what was played last
+        app.romPath = rg_bench_get_config()->rom;
+        app.bootFlags = 0;
+        app.saveSlot = 0;
+    }
     app.isLauncher = strcmp(app.name, "launcher") == 0; // Might be overriden after init
 
     rg_display_init();
@@ -444,6 +487,7 @@ rg_app_t *rg_system_init(int sampleRate, const rg_handlers_t *handlers, const rg
 #endif
 
     rg_task_create("rg_sysmon", &system_monitor_task, NULL, 3 * 1024, RG_TASK_PRIORITY_5, -1);
+    rg_emu_set_rewind(rg_settings_get_number(NS_GLOBAL, SETTING_REWIND, 0));
     app.initialized = true;
 
     RG_LOGI("Retro-Go ready.\n\n");
@@ -473,7 +517,8 @@ static int task_wrapper(void *arg)
 }
 #endif
 
-bool rg_task_create(const char *name, void (*taskFunc)(void *data), void *data, size_t stackSize, int priority, int affinity)
+static bool task_create(const char *name, void (*taskFunc)(void *data), void *data, size_t stackSize, int priority,
+                        int affinity, bool optional)
 {
     RG_ASSERT(name && taskFunc, "bad param");
     rg_task_t *task = NULL;
@@ -485,6 +530,11 @@ bool rg_task_create(const char *name, void (*taskFunc)(void *data), void *data,
         task = &tasks[i];
         break;
     }
+    if (!task && optional)
+    {
+        RG_LOGE("Out of task slots: name='%s'\n", name);
+        return false;
+    }
     RG_ASSERT(task, "Out of task slots");
 
     task->func = taskFunc;
@@ -511,6 +561,16 @@ bool rg_task_create(const char *name, void (*taskFunc)(void *data), void *data,
     return false;
 }
 
+bool rg_task_create(const char *name, void (*taskFunc)(void *data), void *data, size_t stackSize, int priority, int affinity)
+{
+    return task_create(name, taskFunc, data, stackSize, priority, affinity, false);
+}
+
+bool rg_task_try_create(const char *name, void (*taskFunc)(void *data), void *data, size_t stackSize, int priority, int affinity)
+{
+    return task_create(name, taskFunc, data, stackSize, priority, affinity, true);
+}
+
 void rg_task_delay(int ms)
 {
 #ifdef ESP_PLATFORM
@@ -530,6 +590,7 @@ void rg_task_yield(void)
 #endif
 }
 
+#ifdef ESP_PLATFORM
 rg_queue_t *rg_queue_create(size_t length, size_t itemSize)
 {
     return (rg_queue_t *)xQueueCreate(length, itemSize);
@@ -568,6 +629,117 @@ bool rg_queue_is_full(rg_queue_t *queue)
 {
     return uxQueueSpacesAvailable((QueueHandle_t)queue) == 0;
 }
+#else
+typedef struct
+{
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    size_t length, itemSize;
+    size_t head, count;
+    uint8_t items[];
+} sdl_queue_t;
+
+// Waits until an item can be sent (or received), the queue's mutex must be held
+static bool queue_wait(sdl_queue_t *q, bool send, int timeoutMS)
+{
+    uint32_t deadline = SDL_GetTicks() + timeoutMS;
+    while (send ? q->count == q->length : q->count == 0)
+    {
+        if (timeoutMS < 0)
+            SDL_CondWait(q->cond, q->mutex);
+        else if ((int32_t)(deadline - SDL_GetTicks()) <= 0)
+            return false;
+        else
+            SDL_CondWaitTimeout(q->cond, q->mutex, deadline - SDL_GetTicks());
+    }
+    return true;
+}
+
+rg_queue_t *rg_queue_create(size_t length, size_t itemSize)
+{
+    sdl_queue_t *q = calloc(1, sizeof(sdl_queue_t) + length * itemSize);
+    if (!q)
+        return NULL;
+    q->mutex = SDL_CreateMutex();
+    q->cond = SDL_CreateCond();
+    q->length = length;
+    q->itemSize = itemSize;
+    return (rg_queue_t *)q;
+}
+
+void rg_queue_free(rg_queue_t *queue)
+{
+    sdl_queue_t *q = queue;
+    if (!q)
+        return;
+    SDL_DestroyCond(q->cond);
+    SDL_DestroyMutex(q->mutex);
+    free(q);
+}
+
+bool rg_queue_send(rg_queue_t *queue, const void *item, int timeoutMS)
+{
+    sdl_queue_t *q = queue;
+    SDL_LockMutex(q->mutex);
+    bool sent = queue_wait(q, true, timeoutMS);
+    if (sent)
+    {
+        // Like FreeRTOS, a zero itemSize makes it a semaphore and item can be NULL
+        if (q->itemSize)
+            memcpy(q->items + ((q->head + q->count) % q->length) * q->itemSize, item, q->itemSize);
+        q->count++;
+        SDL_CondBroadcast(q->cond);
+    }
+    SDL_UnlockMutex(q->mutex);
+    return sent;
+}
+
+bool rg_queue_receive(rg_queue_t *queue, void *out, int timeoutMS)
+{
+    sdl_queue_t *q = queue;
+    SDL_LockMutex(q->mutex);
+    bool received = queue_wait(q, false, timeoutMS);
+    if (received)
+    {
+        if (q->itemSize && out)
+            memcpy(out, q->items + q->head * q->itemSize, q->itemSize);
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        SDL_CondBroadcast(q->cond);
+    }
+    SDL_UnlockMutex(q->mutex);
+    return received;
+}
+
+bool rg_queue_peek(rg_queue_t *queue, void *out, int timeoutMS)
+{
+    sdl_queue_t *q = queue;
+    SDL_LockMutex(q->mutex);
+    bool received = queue_wait(q, false, timeoutMS);
+    if (received && q->itemSize && out)
+        memcpy(out, q->items + q->head * q->itemSize, q->itemSize);
+    SDL_UnlockMutex(q->mutex);
+    return received;
+}
+
+bool rg_queue_is_empty(rg_queue_t *queue)
+{
+    sdl_queue_t *q = queue;
+    SDL_LockMutex(q->mutex);
+    bool empty = q->count == 0;
+    SDL_UnlockMutex(q->mutex);
+    return empty;
+}
+
+bool rg_queue_is_full(rg_queue_t *queue)
+{
+    sdl_queue_t *q = queue;
+    SDL_LockMutex(q->mutex);
+    bool full = q->count == q->length;
+    SDL_UnlockMutex(q->mutex);
+    return full;
+}
+#endif
 
 void rg_system_load_time(void)
 {
@@ -642,6 +814,9 @@ void rg_system_tick(int busyTime)
     statistics.lastTick = rg_system_timer();
     statistics.busyTime += busyTime;
     statistics.ticks++;
+    rg_rewind_tick();
+    rg_state_poll();
+    rg_bench_tick(busyTime);
     // WDT_RELOAD(WDT_TIMEOUT);
 }
 
@@ -666,6 +841,7 @@ static void shutdown_cleanup(void)
     app.exitCalled = true;
     rg_display_clear(C_BLACK);                // Let the user know that something is happening
     rg_gui_draw_hourglass();                  // ...
+    rg_state_wait();                          // Finish writing the last save state, if any
     rg_system_event(RG_EVENT_SHUTDOWN, NULL); // Allow apps to save their state if they want
     rg_audio_deinit();                        // Disable sound ASAP to avoid audio garbage
     rg_system_save_time();                    // RTC might save to storage, do it before
@@ -722,6 +898,9 @@ void rg_system_switch_app(const char *partition, const char *name, const char *a
 {
     RG_LOGI("Switching to app %s (%s)", partition ?: "-", name ?: "-");
 
+    // A pending save would update the boot flags behind our back
+    rg_state_wait();
+
     if (app.initialized)
     {
         rg_settings_set_string(NS_BOOT, SETTING_BOOT_NAME, name);
@@ -1056,7 +1235,7 @@ bool rg_emu_load_state(uint8_t slot)
     if (slot == 0xFF)
         slot = app.saveSlot;
 
-    if (!app.romPath || !app.handlers.loadState)
+    if (!app.romPath || (!app.handlers.loadState && !app.handlers.loadStateMem))
     {
         RG_LOGE("No rom or handler defined...\n");
         return false;
@@ -1069,13 +1248,21 @@ bool rg_emu_load_state(uint8_t slot)
 
     rg_gui_draw_hourglass();
 
-    if (!(success = (*app.handlers.loadState)(filename)))
+    // Memory states understand the deltas written by rg_state_save, we only use the file handler
+    // as a fallback (eg not enough memory)
+    if (app.handlers.loadStateMem)
+        success = rg_state_load(filename);
+    if (!success && app.handlers.loadState)
+        success = (*app.handlers.loadState)(filename);
+
+    if (!success)
     {
         RG_LOGE("Load failed!\n");
     }
     else
     {
         emu_update_save_slot(slot);
+        rg_rewind_reset();
     }
 
     free(filename);
@@ -1083,12 +1270,53 @@ bool rg_emu_load_state(uint8_t slot)
     return success;
 }
 
+static void save_state_done(const char *filename, bool success, void *arg)
+{
+    rg_display_osd_clear();
+
+    if (success)
+        emu_update_save_slot((uintptr_t)arg);
+    else
+        rg_gui_alert("Save failed", NULL);
+
+    rg_storage_commit();
+    rg_system_set_led(0);
+}
+
+static bool save_state_async(const char *filename, uint8_t slot)
+{
+    char *preview_path = rg_emu_get_path(RG_PATH_SCREENSHOT + slot, app.romPath);
+    const rg_surface_t *frame = rg_display_get_last_update();
+    int width = rg_display_get_info()->screen.width / 2;
+    rg_surface_t *preview = NULL;
+
+    // Scaling the last frame is quick, it's the PNG encoding that takes time
+    if (frame && rg_storage_mkdir(rg_dirname(preview_path)))
+        preview = rg_surface_convert(frame, width, 0, RG_PIXEL_888);
+    else
+        rg_emu_screenshot(preview_path, width, 0);
+
+    bool success = rg_state_save_async(filename, preview, preview ? preview_path : NULL, &save_state_done,
+                                       (void *)(uintptr_t)slot);
+    free(preview_path);
+
+    if (success)
+    {
+        // Stays up (with the LED) until save_state_done
+        rg_gui_set_osd(true);
+        rg_gui_draw_text(RG_GUI_RIGHT, RG_GUI_TOP, 0, "Saving...", C_WHITE, C_BLACK, 0);
+        rg_gui_set_osd(false);
+    }
+
+    return success;
+}
+
 bool rg_emu_save_state(uint8_t slot)
 {
     if (slot == 0xFF)
         slot = app.saveSlot;
 
-    if (!app.romPath || !app.handlers.saveState)
+    if (!app.romPath || (!app.handlers.saveState && !app.handlers.saveStateMem))
     {
         RG_LOGE("No rom or handler defined...\n");
         return false;
@@ -1101,21 +1329,33 @@ bool rg_emu_save_state(uint8_t slot)
     RG_LOGI("Saving state to '%s'.\n", filename);
 
     rg_system_set_led(1);
-    rg_gui_draw_hourglass();
 
     if (!rg_storage_mkdir(rg_dirname(filename)))
     {
         RG_LOGE("Unable to create dir, save might fail...\n");
     }
 
+    // Only the serialization happens here, the game resumes while the writer task does the rest
+    if (app.handlers.saveStateMem && save_state_async(filename, slot))
+    {
+        free(filename);
+        return true;
+    }
+
+    rg_gui_draw_hourglass();
+
+    // The file is replaced behind rg_state's back, its cached base no longer matches (no deltas against it!)
+    rg_state_forget();
+
     #define tempname(ext) strcat(strcpy(tempname, filename), ext)
 
-    if ((*app.handlers.saveState)(tempname(".new")))
+    if (app.handlers.saveState && (*app.handlers.saveState)(tempname(".new")))
     {
         rename(filename, tempname(".bak"));
 
         if (rename(tempname(".new"), filename) == 0)
         {
+            remove(tempname(".delta"));
             remove(tempname(".bak"));
             success = true;
         }
@@ -1176,6 +1416,8 @@ rg_emu_states_t *rg_emu_get_states(const char *romPath, size_t slots)
     rg_emu_states_t *result = calloc(1, sizeof(rg_emu_states_t) + sizeof(rg_emu_slot_t) * slots);
     uint8_t last_used_slot = 0xFF;
 
+    rg_state_wait(); // The slots must be up to date
+
     char *filename = rg_emu_get_path(RG_PATH_SAVE_STATE + 0xFF, romPath);
     FILE *fp = fopen(filename, "rb");
     if (fp)
@@ -1191,6 +1433,14 @@ rg_emu_states_t *rg_emu_get_states(const char *romPath, size_t slots)
         char *preview = rg_emu_get_path(RG_PATH_SCREENSHOT + i, romPath);
         char *file = rg_emu_get_path(RG_PATH_SAVE_STATE + i, romPath);
         rg_stat_t info = rg_storage_stat(file);
+        if (info.exists)
+        {
+            // A delta is a newer version of the same slot
+            char delta[RG_PATH_MAX + 8];
+            rg_stat_t delta_info = rg_storage_stat(strcat(strcpy(delta, file), ".delta"));
+            if (delta_info.exists && delta_info.mtime > info.mtime)
+                info.mtime = delta_info.mtime;
+        }
         strcpy(slot->preview, preview);
         strcpy(slot->file, file);
         slot->id = i;
@@ -1221,6 +1471,8 @@ bool rg_emu_reset(bool hard)
 {
     app.frameskip = 0;
     app.speed = 1.f;
+    rg_audio_set_speed(app.speed);
+    rg_rewind_reset();
     if (app.handlers.reset)
         return app.handlers.reset(hard);
     return false;
@@ -1230,7 +1482,7 @@ void rg_emu_set_speed(float speed)
 {
     app.speed = RG_MIN(2.5f, RG_MAX(0.5f, speed));
     app.frameskip = RG_MAX(app.frameskip, (app.speed > 1.0f) ? 2 : 0);
-    rg_audio_set_sample_rate(app.sampleRate * app.speed);
+    rg_audio_set_speed(app.speed);
     rg_system_event(RG_EVENT_SPEEDUP, NULL);
 }
 
@@ -1239,6 +1491,76 @@ float rg_emu_get_speed(void)
     return app.speed;
 }
 
+bool rg_emu_set_rewind(bool enable)
+{
+    if (app.initialized)
+        rg_settings_set_number(NS_GLOBAL, SETTING_REWIND, enable);
+    // The history lives in external memory, there's no room for it otherwise
+    if (enable && !app.lowMemoryMode && app.handlers.saveStateMem)
+        return rg_rewind_init(REWIND_HISTORY_SIZE, REWIND_INTERVAL);
+    rg_rewind_deinit();
+    return false;
+}
+
+bool rg_emu_get_rewind(void)
+{
+    return rg_rewind_enabled();
+}
+
+void rg_emu_set_run_ahead(int frames)
+{
+    runAhead.frames = RG_MAX(0, RG_MIN(frames, 4));
+    if (runAhead.frames == 0)
+    {
+        free(runAhead.buffer);
+        runAhead.buffer = NULL;
+        runAhead.capacity = 0;
+    }
+    RG_LOGI("Run-ahead: %d frames.\n", runAhead.frames);
+}
+
+int rg_emu_get_run_ahead(void)
+{
+    return runAhead.frames;
+}
+
+bool rg_emu_run_ahead_begin(void)
+{
+    if (runAhead.frames <= 0 || !app.handlers.saveStateMem || !app.handlers.loadStateMem)
+        return false;
+
+    runAhead.startTime = rg_system_timer();
+    runAhead.size = runAhead.capacity;
+
+    while (!app.handlers.saveStateMem(runAhead.buffer, &runAhead.size))
+    {
+        // First use or the state grew, the handler may tell us how much it needs
+        size_t size = RG_MAX(runAhead.size, RG_MAX(runAhead.capacity * 2, 4096));
+        free(runAhead.buffer);
+        runAhead.buffer = size <= 1024 * 1024 ? rg_alloc(size, MEM_SLOW | MEM_NOPANIC) : NULL;
+        if (!runAhead.buffer)
+        {
+            RG_LOGE("Failed to snapshot the state, run-ahead disabled.\n");
+            rg_emu_set_run_ahead(0);
+            return false;
+        }
+        runAhead.capacity = runAhead.size = size;
+    }
+
+    return true;
+}
+
+void rg_emu_run_ahead_end(void)
+{
+    if (!app.handlers.loadStateMem(runAhead.buffer, runAhead.size))
+    {
+        RG_LOGE("Failed to roll back, run-ahead disabled.\n");
+        rg_emu_set_run_ahead(0);
+    }
+    runAhead.totalTime += rg_system_timer() - runAhead.startTime;
+    runAhead.ticks++;
+}
+
 #ifdef RG_ENABLE_PROFILING
 // Note this profiler might be inaccurate because of:
 // https://gcc.gnu.org/bugzilla/show_bug.cgi?id=28205
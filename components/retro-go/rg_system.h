@@ -27,6 +27,10 @@ extern "C" {
 #endif
 
 #include "rg_audio.h"
+#include "rg_bench.h"
+#include "rg_rewind.h"
+#include "rg_chunk.h"
+#include "rg_pager.h"
 #include "rg_display.h"
 #include "rg_input.h"
 #include "rg_storage.h"
@@ -120,6 +124,8 @@ typedef enum
 } rg_event_t;
 
 typedef bool (*rg_state_handler_t)(const char *filename);
+typedef bool (*rg_state_mem_save_handler_t)(void *buffer, size_t *size);
+typedef bool (*rg_state_mem_load_handler_t)(const void *buffer, size_t size);
 typedef bool (*rg_reset_handler_t)(bool hard);
 typedef void (*rg_event_handler_t)(int event, void *data);
 typedef bool (*rg_screenshot_handler_t)(const char *filename, int width, int height);
@@ -135,6 +141,8 @@ typedef struct
     rg_event_handler_t event;           // listen to retro-go system events
     rg_mem_read_handler_t memRead;      // Used by for cheats and debugging
     rg_mem_write_handler_t memWrite;    // Used by for cheats and debugging
+    rg_state_mem_save_handler_t saveStateMem; // Used by rewind. *size is the capacity in, the state size out
+    rg_state_mem_load_handler_t loadStateMem; // Used by rewind
 } rg_handlers_t;
 
 typedef struct
@@ -208,6 +216,9 @@ typedef struct
     int freeBlockInt;
     int freeBlockExt;
     int freeStackMain;
+    int runAheadFrames;    // Frames emulated past the presented one
+    float runAheadLatency; // Input lag hidden by run-ahead, in ms (measured frame time * frames)
+    float runAheadPercent; // Time spent running ahead and rolling back
 } rg_stats_t;
 
 rg_app_t *rg_system_init(int sampleRate, const rg_handlers_t *handlers, const rg_gui_option_t *options);
@@ -243,6 +254,8 @@ void rg_system_save_time(void);
 // Wrappers for the OS' task/thread creation API. It also keeps track of handles for debugging purposes...
 // typedef void rg_task_t;
 bool rg_task_create(const char *name, void (*taskFunc)(void *data), void *data, size_t stackSize, int priority, int affinity);
+// Same but running out of task slots isn't fatal, for optional tasks that come and go (capture, state writer...)
+bool rg_task_try_create(const char *name, void (*taskFunc)(void *data), void *data, size_t stackSize, int priority, int affinity);
 // The main difference between rg_task_delay and rg_usleep is that rg_task_delay will yield
 // to other tasks and will not busy wait time smaller than a tick. Meaning rg_usleep
 // is more accurate but rg_task_delay is more multitasking-friendly.
@@ -268,6 +281,15 @@ bool rg_emu_screenshot(const char *filename, int width, int height);
 rg_emu_states_t *rg_emu_get_states(const char *romPath, size_t slots);
 void rg_emu_set_speed(float speed);
 float rg_emu_get_speed(void);
+bool rg_emu_set_rewind(bool enable);
+bool rg_emu_get_rewind(void);
+// Run-ahead, for cores whose frame loop supports it. After emulating the real frame (not drawn):
+//   if (rg_emu_run_ahead_begin()) { emulate rg_emu_get_run_ahead() frames, draw the last; rg_emu_run_ahead_end(); }
+// The audio of the frames run ahead must be discarded.
+void rg_emu_set_run_ahead(int frames);
+int rg_emu_get_run_ahead(void);
+bool rg_emu_run_ahead_begin(void);
+void rg_emu_run_ahead_end(void);
 
 /* Utilities */
 
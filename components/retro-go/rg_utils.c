@@ -247,6 +247,23 @@ void *rg_alloc(size_t size, uint32_t caps)
     return ptr;
 }
 
+// Unlike rg_system_get_counters(), which is refreshed every few seconds, this asks the heap right now.
+// The host has no meaningful limit, it reports a fixed amount that is plenty for any ROM.
+size_t rg_free_memory(uint32_t caps, size_t *largest_block)
+{
+#ifdef ESP_PLATFORM
+    uint32_t esp_caps = (caps & MEM_SLOW ? MALLOC_CAP_SPIRAM : (caps & MEM_FAST ? MALLOC_CAP_INTERNAL : 0));
+    esp_caps |= (caps & MEM_32BIT ? MALLOC_CAP_32BIT : MALLOC_CAP_8BIT);
+    if (largest_block)
+        *largest_block = heap_caps_get_largest_free_block(esp_caps);
+    return heap_caps_get_free_size(esp_caps);
+#else
+    if (largest_block)
+        *largest_block = 256 * 1024 * 1024;
+    return 256 * 1024 * 1024;
+#endif
+}
+
 void rg_usleep(uint32_t us)
 {
     int64_t goal = rg_system_timer() + us;
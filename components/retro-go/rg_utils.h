@@ -66,6 +66,7 @@ const char *rg_relpath(const char *path);
 uint32_t rg_crc32(uint32_t crc, const uint8_t *buf, size_t len);
 uint32_t rg_hash(const char *buf, size_t len);
 void *rg_alloc(size_t size, uint32_t caps);
+size_t rg_free_memory(uint32_t caps, size_t *largest_block);
 void rg_usleep(uint32_t us);
 
 #define MEM_ANY   (0)
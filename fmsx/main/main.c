@@ -4,7 +4,7 @@
 #define AUDIO_SAMPLE_RATE (32000)
 #define AUDIO_BUFFER_LENGTH (AUDIO_SAMPLE_RATE / 60 + 1)
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 static rg_queue_t *audioQueue;
 static rg_app_t *app;
@@ -252,7 +252,7 @@ void PutImage(void)
         DrawKeyboard(&NormScreen, KBDKeys[KeyboardRow][KeyboardCol]);
 
     SubmitFrame();
-    currentUpdate = updates[currentUpdate == updates[0]];
+    currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates));
     NormScreen.Data = currentUpdate->data;
     XBuf = NormScreen.Data;
 }
@@ -450,6 +450,9 @@ void app_main(void)
 
     updates[0] = rg_surface_create(WIDTH, HEIGHT, RG_PIXEL_565_BE, MEM_FAST);
     updates[1] = rg_surface_create(WIDTH, HEIGHT, RG_PIXEL_565_BE, MEM_FAST);
+    // A third buffer lets us start a frame while another is pending and one is being drawn
+    if (!app->lowMemoryMode)
+        updates[2] = rg_surface_create(WIDTH, HEIGHT, RG_PIXEL_565_BE, MEM_SLOW | MEM_NOPANIC);
     currentUpdate = updates[0];
 
     KeyboardEmulation = rg_settings_get_number(NS_APP, "Input", 1);
@@ -27,14 +27,19 @@ int16_t gwenesis_ym2612_buffer[AUDIO_BUFFER_LENGTH];
 int ym2612_index;
 int ym2612_clock;
 
+// Bump it when the layout of a saved variable changes, older builds will then ignore it
+#define SAVESTATE_CHUNK_VERSION 1
+
 static FILE *savestate_fp = NULL;
 static int savestate_errors = 0;
+static bool savestate_legacy = false; // Flat svar_t list, before the chunked container
+static bool savestate_compress = false;
 
 static bool yfm_enabled = true;
 static bool z80_enabled = true;
 static bool sn76489_enabled = true;
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 static rg_app_t *app;
 
@@ -76,6 +81,20 @@ void saveGwenesisStateGetBuffer(SaveState* state, const char* tagName, void* buf
     bool from_start = false;
     svar_t var;
 
+    if (!savestate_legacy)
+    {
+        rg_chunk_t chunk;
+        if (rg_chunk_find(savestate_fp, rg_chunk_id(tagName), SAVESTATE_CHUNK_VERSION, &chunk)
+            && rg_chunk_read(savestate_fp, &chunk, buffer, length))
+        {
+            RG_LOGD("Loaded key '%s'\n", tagName);
+            return;
+        }
+        RG_LOGW("Key %s NOT FOUND!\n", tagName);
+        savestate_errors++;
+        return;
+    }
+
     // Odds are that calls to this func will be in order, so try searching from current file position.
     while (!from_start || ftell(savestate_fp) < initial_pos)
     {
@@ -92,7 +111,7 @@ void saveGwenesisStateGetBuffer(SaveState* state, const char* tagName, void* buf
         if (strncmp(var.key, tagName, sizeof(var.key)) == 0)
         {
             fread(buffer, RG_MIN(var.length, length), 1, savestate_fp);
-            RG_LOGI("Loaded key '%s'\n", tagName);
+            RG_LOGD("Loaded key '%s'\n", tagName);
             return;
         }
         fseek(savestate_fp, var.length, SEEK_CUR);
@@ -104,11 +123,9 @@ void saveGwenesisStateGetBuffer(SaveState* state, const char* tagName, void* buf
 void saveGwenesisStateSetBuffer(SaveState* state, const char* tagName, void* buffer, int length)
 {
     // TO DO: seek the file to find if the key already exists. It's possible it could be written twice.
-    svar_t var = {{0}, length};
-    strncpy(var.key, tagName, sizeof(var.key) - 1);
-    fwrite(&var, sizeof(var), 1, savestate_fp);
-    fwrite(buffer, length, 1, savestate_fp);
-    RG_LOGI("Saved key '%s'\n", tagName);
+    if (!rg_chunk_write(savestate_fp, rg_chunk_id(tagName), SAVESTATE_CHUNK_VERSION, buffer, length, savestate_compress))
+        savestate_errors++;
+    RG_LOGD("Saved key '%s'\n", tagName);
 }
 
 void gwenesis_io_get_buttons()
@@ -154,35 +171,78 @@ static rg_gui_event_t z80_update_cb(rg_gui_option_t *option, rg_gui_event_t even
 
 static bool screenshot_handler(const char *filename, int width, int height)
 {
-    return rg_surface_save_image_file(currentUpdate, filename, width, height);
+    return rg_surface_save_image_file(rg_display_get_last_update() ?: currentUpdate, filename, width, height);
+}
+
+// The tag/value callbacks above go through savestate_fp, which can be a file or a memory stream.
+// Memory states aren't compressed, they're taken often (rewind, run-ahead) and rg_state diffs them.
+static bool save_state_fp(FILE *fp, bool compress)
+{
+    savestate_fp = fp;
+    savestate_compress = compress;
+    savestate_errors = !rg_chunk_write_header(savestate_fp);
+    gwenesis_save_state();
+    savestate_fp = NULL;
+    return savestate_errors == 0;
+}
+
+static bool load_state_fp(FILE *fp)
+{
+    savestate_fp = fp;
+    savestate_errors = 0;
+    // States saved by older versions are read as before
+    if ((savestate_legacy = !rg_chunk_check_header(savestate_fp)))
+        fseek(savestate_fp, 0, SEEK_SET);
+    gwenesis_load_state();
+    savestate_fp = NULL;
+    return savestate_errors == 0;
 }
 
 static bool save_state_handler(const char *filename)
 {
-    if ((savestate_fp = fopen(filename, "wb")))
+    FILE *fp = fopen(filename, "wb");
+    if (fp)
     {
-        savestate_errors = 0;
-        gwenesis_save_state();
-        fclose(savestate_fp);
-        return savestate_errors == 0;
+        bool success = save_state_fp(fp, true);
+        fclose(fp);
+        return success;
     }
     return false;
 }
 
 static bool load_state_handler(const char *filename)
 {
-    if ((savestate_fp = fopen(filename, "rb")))
+    FILE *fp = fopen(filename, "rb");
+    if (fp)
     {
-        savestate_errors = 0;
-        gwenesis_load_state();
-        fclose(savestate_fp);
-        if (savestate_errors == 0)
+        bool success = load_state_fp(fp);
+        fclose(fp);
+        if (success)
             return true;
     }
     reset_emulation();
     return false;
 }
 
+static bool save_state_mem_handler(void *buffer, size_t *size)
+{
+    FILE *fp = rg_storage_open_mem(buffer, *size, "wb");
+    bool success = fp && save_state_fp(fp, false);
+    *size = rg_storage_close_mem(fp);
+    return success && *size > 0;
+}
+
+static bool load_state_mem_handler(const void *buffer, size_t size)
+{
+    FILE *fp = rg_storage_open_mem((void *)buffer, size, "rb");
+    bool success = fp && load_state_fp(fp);
+    rg_storage_close_mem(fp);
+    // A partial load leaves the machine half restored
+    if (!success)
+        reset_emulation();
+    return success;
+}
+
 static bool reset_handler(bool hard)
 {
     reset_emulation();
@@ -193,7 +253,7 @@ static void event_handler(int event, void *arg)
 {
     if (event == RG_EVENT_REDRAW)
     {
-        rg_display_submit(currentUpdate, 0);
+        rg_display_submit(rg_display_get_last_update() ?: currentUpdate, 0);
     }
 }
 
@@ -205,6 +265,8 @@ void app_main(void)
         .reset = &reset_handler,
         .screenshot = &screenshot_handler,
         .event = &event_handler,
+        .saveStateMem = &save_state_mem_handler,
+        .loadStateMem = &load_state_mem_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "YM2612 audio ", "-", RG_DIALOG_FLAG_NORMAL, &yfm_update_cb},
@@ -220,28 +282,33 @@ void app_main(void)
     z80_enabled = rg_settings_get_number(NS_APP, SETTING_Z80_EMULATION, 1);
 
     updates[0] = rg_surface_create(320, 241, RG_PIXEL_PAL565_BE, MEM_FAST);
-    // updates[1] = rg_surface_create(320, 241, RG_PIXEL_PAL565_BE, MEM_FAST);
     currentUpdate = updates[0];
 
-    // This is a hack because our new surface format doesn't yet support overdraw space easily
-    updates[0]->data += 160;
-    updates[0]->height = 240;
-    // updates[1]->data += 160;
-    // updates[1]->height = 240;
-
     VRAM = rg_alloc(VRAM_MAX_SIZE, MEM_FAST);
 
+    // Internal memory is too tight for more buffers. Without them we fall back to skipping
+    // frames while the display is busy, because we would be drawing into the frame it's reading.
+    updates[1] = rg_surface_create(320, 241, RG_PIXEL_PAL565_BE, MEM_SLOW | MEM_NOPANIC);
+    if (updates[1])
+        updates[2] = rg_surface_create(320, 241, RG_PIXEL_PAL565_BE, MEM_SLOW | MEM_NOPANIC);
+
+    // This is a hack because our new surface format doesn't yet support overdraw space easily
+    for (size_t i = 0; i < RG_COUNT(updates) && updates[i]; ++i)
+    {
+        updates[i]->data += 160;
+        updates[i]->height = 240;
+    }
+
     RG_LOGI("Genesis start\n");
 
-    FILE *fp = fopen(app->romPath, "rb");
-    if (!fp)
+    rg_rom_file_t *rom = rg_storage_rom_open(app->romPath);
+    if (!rom)
         RG_PANIC("Rom load failed");
-    fseek(fp, 0, SEEK_END);
-    size_t rom_size = ftell(fp);
+    size_t rom_size = rg_storage_rom_size(rom);
     void *rom_data = malloc((rom_size & ~0xFFFF) + 0x10000);
-    fseek(fp, 0, SEEK_SET);
-    fread(rom_data, 1, rom_size, fp);
-    fclose(fp);
+    if (!rom_data || !rg_storage_rom_read(rom, rom_data, rom_size))
+        RG_PANIC("Rom load failed");
+    rg_storage_rom_close(rom);
 
     RG_LOGI("load_cartridge(%p, %d)\n", rom_data, rom_size);
     load_cartridge(rom_data, rom_size);
@@ -392,10 +459,18 @@ void app_main(void)
         {
             for (int i = 0; i < 256; ++i)
                 currentUpdate->palette[i] = (CRAM565[i] << 8) | (CRAM565[i] >> 8);
-            slowFrame = !rg_display_sync(false);
             currentUpdate->width = screen_width;
             currentUpdate->height = screen_height;
-            rg_display_submit(currentUpdate, 0);
+            if (updates[1])
+            {
+                rg_display_submit(currentUpdate, 0);
+                currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates));
+            }
+            else
+            {
+                slowFrame = !rg_display_sync(false);
+                rg_display_submit(currentUpdate, 0);
+            }
         }
 
         rg_system_tick(rg_system_timer() - startTime);
@@ -603,8 +603,11 @@ void application_show_file_menu(retro_file_t *file, bool advanced)
     case 2:
         while ((slot = rg_gui_savestate_menu("Delete save?", rom_path, 0)) != -1)
         {
+            char delta[RG_PATH_MAX + 8];
+            snprintf(delta, sizeof(delta), "%s.delta", savestates->slots[slot].file);
             remove(savestates->slots[slot].preview);
             remove(savestates->slots[slot].file);
+            remove(delta);
         }
         if (has_sram && rg_gui_confirm("Delete sram file?", 0, 0))
         {
@@ -666,17 +669,17 @@ static void application(const char *desc, const char *name, const char *exts, co
 
 void applications_init(void)
 {
-    application("Nintendo Entertainment System", "nes", "nes fc fds nsf", "retro-core", 16);
+    application("Nintendo Entertainment System", "nes", "nes fc fds nsf zip gz lz4", "retro-core", 16);
     application("Super Nintendo", "snes", "smc sfc", "retro-core", 0);
     application("Nintendo Gameboy", "gb", "gb gbc", "retro-core", 0);
     application("Nintendo Gameboy Color", "gbc", "gbc gb", "retro-core", 0);
     application("Nintendo Game & Watch", "gw", "gw", "retro-core", 0);
     // application("Sega SG-1000", "sg1", "sms sg sg1", "retro-core", 0);
-    application("Sega Master System", "sms", "sms sg", "retro-core", 0);
-    application("Sega Game Gear", "gg", "gg", "retro-core", 0);
-    application("Sega Mega Drive", "md", "md gen bin", "gwenesis", 0);
-    application("Coleco ColecoVision", "col", "col rom", "retro-core", 0);
-    application("NEC PC Engine", "pce", "pce", "retro-core", 0);
+    application("Sega Master System", "sms", "sms sg zip gz lz4", "retro-core", 0);
+    application("Sega Game Gear", "gg", "gg zip gz lz4", "retro-core", 0);
+    application("Sega Mega Drive", "md", "md gen bin zip gz lz4", "gwenesis", 0);
+    application("Coleco ColecoVision", "col", "col rom zip gz lz4", "retro-core", 0);
+    application("NEC PC Engine", "pce", "pce zip gz lz4", "retro-core", 0);
     application("Atari Lynx", "lnx", "lnx", "retro-core", 64);
     // application("Atari 2600", "a26", "a26", "stella-go", 0);
     // application("Neo Geo Pocket Color", "ngp", "ngp ngc", "ngpocket-go", 0);
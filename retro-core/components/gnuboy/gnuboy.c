@@ -146,33 +146,92 @@ int gnuboy_load_bios(const char *file)
 }
 
 
-void gnuboy_load_bank(int bank)
+#define BANK_SIZE 0x4000
+
+static int bank_budget = 0;
+static bool bank_prefetch = false;
+
+#ifdef RETRO_GO
+#define get_time_us() rg_system_timer()
+
+// The prefetcher reads the banks next to the current one with its own file handle, into a spare
+// buffer that the emulation thread swaps in at the next bank switch. There's at most one read in flight.
+static struct
 {
-	const size_t BANK_SIZE = 0x4000;
-	const size_t OFFSET = bank * BANK_SIZE;
+	rg_queue_t *requests;
+	rg_queue_t *results;
+	FILE *fp;
+	byte *buffer;
+	int pending;
+} prefetch = {.pending = -1};
+#else
+#define get_time_us() 0
+#endif
 
-	if (!cart.rombanks[bank])
-		cart.rombanks[bank] = malloc(BANK_SIZE);
 
-	if (!cart.romFile)
-		return;
+// Picks the least recently mapped bank, except bank 0 and the banks in use
+static int find_victim(int keep)
+{
+	int victim = -1;
 
-	MESSAGE_INFO("loading bank %d.\n", bank);
-	while (!cart.rombanks[bank])
+	for (int i = 1; i < cart.romsize; i++)
 	{
-		int i = rand() & 0xFF;
-		if (cart.rombanks[i])
-		{
-			MESSAGE_INFO("reclaiming bank %d.\n", i);
-			cart.rombanks[bank] = cart.rombanks[i];
-			cart.rombanks[i] = NULL;
-			break;
-		}
+		if (!cart.rombanks[i] || i == keep || i == cart.mappedbank)
+			continue;
+		if (victim < 0 || cart.bankstamps[i] < cart.bankstamps[victim])
+			victim = i;
 	}
 
+	return victim;
+}
+
+
+// Returns a buffer for a new bank, reclaiming one if we reached our budget or ran out of memory
+static byte *alloc_bank(int keep)
+{
+	byte *buffer = NULL;
+
+	if (cart.bankstats.loaded < cart.bankstats.budget)
+		buffer = malloc(BANK_SIZE);
+
+	if (!buffer)
+	{
+		int victim = find_victim(keep);
+		if (victim < 0)
+			return NULL;
+		MESSAGE_DEBUG("reclaiming bank %d.\n", victim);
+		buffer = cart.rombanks[victim];
+		cart.rombanks[victim] = NULL;
+		cart.bankstats.loaded--;
+		cart.bankstats.evictions++;
+	}
+
+	return buffer;
+}
+
+
+static void read_bank(int bank)
+{
+	byte *buffer = alloc_bank(bank);
+
+	if (!buffer)
+	{
+		MESSAGE_ERROR("No memory left for bank %d!\n", bank);
+		abort();
+	}
+
+	cart.rombanks[bank] = buffer;
+	cart.bankstamps[bank] = cart.bankclock;
+	cart.bankstats.loaded++;
+
+	if (!cart.romFile)
+		return;
+
+	MESSAGE_DEBUG("loading bank %d.\n", bank);
+
 	// Load the 16K page
-	if (fseek(cart.romFile, OFFSET, SEEK_SET) != 0
-		|| !fread(cart.rombanks[bank], BANK_SIZE, 1, cart.romFile))
+	if (fseek(cart.romFile, bank * BANK_SIZE, SEEK_SET) != 0
+		|| !fread(buffer, BANK_SIZE, 1, cart.romFile))
 	{
 		MESSAGE_WARN("ROM bank loading failed\n");
 		if (!feof(cart.romFile))
@@ -181,6 +240,170 @@ void gnuboy_load_bank(int bank)
 }
 
 
+#ifdef RETRO_GO
+static void prefetch_task(void *arg)
+{
+	int bank;
+
+	// A negative bank asks the task to exit, it's acknowledged with a negative result too
+	while (rg_queue_receive(prefetch.requests, &bank, -1) && bank >= 0)
+	{
+		if (fseek(prefetch.fp, bank * BANK_SIZE, SEEK_SET) != 0
+			|| !fread(prefetch.buffer, BANK_SIZE, 1, prefetch.fp))
+			bank = -1;
+		rg_queue_send(prefetch.results, &bank, -1);
+	}
+
+	bank = -1;
+	rg_queue_send(prefetch.results, &bank, -1);
+}
+
+
+// Installs the bank that was read in the background, if any
+static void prefetch_collect(bool wait)
+{
+	int bank;
+
+	if (prefetch.pending < 0 || !rg_queue_receive(prefetch.results, &bank, wait ? -1 : 0))
+		return;
+
+	prefetch.pending = -1;
+
+	// If the read failed or the bank was loaded in the meantime, the buffer stays our spare
+	if (bank < 0 || cart.rombanks[bank])
+		return;
+
+	byte *spare = alloc_bank(bank);
+	cart.rombanks[bank] = prefetch.buffer;
+	cart.bankstamps[bank] = cart.bankclock;
+	cart.bankstats.loaded++;
+	cart.bankstats.prefetches++;
+	prefetch.buffer = spare;
+}
+
+
+static void prefetch_next(int bank)
+{
+	if (!prefetch.fp || prefetch.pending >= 0)
+		return;
+
+	int candidates[2] = {bank + 1, bank - 1};
+
+	for (int i = 0; i < 2; i++)
+	{
+		int next = candidates[i];
+		if (next <= 0 || next >= cart.romsize || cart.rombanks[next])
+			continue;
+		if (!prefetch.buffer && !(prefetch.buffer = alloc_bank(bank)))
+			return;
+		if (rg_queue_send(prefetch.requests, &next, 0))
+			prefetch.pending = next;
+		return;
+	}
+}
+
+
+static void prefetch_start(const char *file)
+{
+	prefetch.pending = -1;
+	if (!(prefetch.fp = fopen(file, "rb")))
+		return;
+
+	prefetch.requests = rg_queue_create(1, sizeof(int));
+	prefetch.results = rg_queue_create(1, sizeof(int));
+	if (!rg_task_try_create("gb_prefetch", &prefetch_task, NULL, 3 * 1024, RG_TASK_PRIORITY_2, -1))
+	{
+		MESSAGE_ERROR("Failed to start the prefetcher, banks will be read on demand\n");
+		rg_queue_free(prefetch.requests);
+		rg_queue_free(prefetch.results);
+		prefetch.requests = prefetch.results = NULL;
+		fclose(prefetch.fp);
+		prefetch.fp = NULL;
+	}
+}
+
+
+static void prefetch_stop(void)
+{
+	int bank;
+
+	if (!prefetch.fp)
+		return;
+
+	if (prefetch.pending >= 0)
+		rg_queue_receive(prefetch.results, &bank, -1);
+	prefetch.pending = -1;
+
+	// Wait for the task to exit before freeing what it uses
+	bank = -1;
+	rg_queue_send(prefetch.requests, &bank, -1);
+	rg_queue_receive(prefetch.results, &bank, -1);
+	rg_queue_free(prefetch.requests);
+	rg_queue_free(prefetch.results);
+	prefetch.requests = prefetch.results = NULL;
+
+	fclose(prefetch.fp);
+	prefetch.fp = NULL;
+	free(prefetch.buffer);
+	prefetch.buffer = NULL;
+}
+#else
+#define prefetch_collect(wait)
+#define prefetch_next(bank)
+#define prefetch_start(file)
+#define prefetch_stop()
+#endif
+
+
+/*
+ * Banks are loaded from the file on demand and kept in memory up to the budget set with
+ * gnuboy_set_bank_cache. After that the least recently mapped bank makes room for the new one.
+ */
+void gnuboy_load_bank(int bank)
+{
+	cart.bankclock++;
+
+	prefetch_collect(prefetch.pending == bank);
+
+	if (cart.rombanks[bank])
+	{
+		cart.bankstats.hits++;
+		cart.bankstamps[bank] = cart.bankclock;
+	}
+	else
+	{
+		int64_t start = get_time_us();
+		read_bank(bank);
+		unsigned elapsed = get_time_us() - start;
+		cart.bankstats.misses++;
+		cart.bankstats.readTime += elapsed;
+		if (elapsed > cart.bankstats.maxReadTime)
+			cart.bankstats.maxReadTime = elapsed;
+	}
+
+	cart.mappedbank = bank;
+
+	prefetch_next(bank);
+}
+
+
+/*
+ * budget is the maximum number of 16KB banks kept in memory (0 means as many as will fit). The prefetcher
+ * needs one more bank for its buffer. Must be called before gnuboy_load_rom.
+ */
+void gnuboy_set_bank_cache(int budget, bool prefetch)
+{
+	bank_budget = budget;
+	bank_prefetch = prefetch;
+}
+
+
+gb_bank_counters_t gnuboy_get_bank_counters(void)
+{
+	return cart.bankstats;
+}
+
+
 int gnuboy_load_rom(const char *file)
 {
 	// Memory Bank Controller names
@@ -288,7 +511,8 @@ int gnuboy_load_rom(const char *file)
 	}
 
 	cart.rombanks = calloc(cart.romsize, sizeof(uint8_t *));
-	if (!cart.rombanks)
+	cart.bankstamps = calloc(cart.romsize, sizeof(uint32_t));
+	if (!cart.rombanks || !cart.bankstamps)
 	{
 		MESSAGE_ERROR("ROMBANKS alloc failed");
 		return -4;
@@ -381,10 +605,23 @@ int gnuboy_load_rom(const char *file)
 		preload = cart.romsize - 40;
 	}
 
-	MESSAGE_INFO("Preloading the first %d banks\n", preload);
+	// We need at least bank 0, the mapped bank and a bank to swap
+	cart.bankstats.budget = bank_budget > 0 ? bank_budget : cart.romsize;
+	if (cart.bankstats.budget < 3)
+		cart.bankstats.budget = 3;
+	if (preload > cart.bankstats.budget)
+		preload = cart.bankstats.budget;
+	cart.mappedbank = -1;
+
+	MESSAGE_INFO("Preloading the first %d banks (budget: %d)\n", preload, cart.bankstats.budget);
 	for (int i = 0; i < preload; i++)
 	{
-		gnuboy_load_bank(i);
+		read_bank(i);
+	}
+
+	if (bank_prefetch && preload < cart.romsize)
+	{
+		prefetch_start(file);
 	}
 
 	// Apply game-specific hacks
@@ -409,6 +646,8 @@ int gnuboy_load_rom(const char *file)
 
 void gnuboy_free_rom(void)
 {
+	prefetch_stop();
+
 	for (int i = 0; i < cart.romsize; i++)
 	{
 		if (cart.rombanks[i]) {
@@ -418,6 +657,8 @@ void gnuboy_free_rom(void)
 	}
 	free(cart.rombanks);
 	cart.rombanks = NULL;
+	free(cart.bankstamps);
+	cart.bankstamps = NULL;
 
 	free(cart.rambanks);
 	cart.rambanks = NULL;
@@ -653,7 +894,7 @@ typedef struct
 } sblock_t;
 
 
-static int do_save_load(const char *file, bool save)
+static int do_save_load(FILE *fp, bool save)
 {
 	uint32_t sav_ver = SAVE_VERSION;
 	const svar_t svars[] =
@@ -738,13 +979,8 @@ static int do_save_load(const char *file, bool save)
 		{NULL, 0},
 	};
 
-	FILE *fp = NULL;
-
 	if (save)
 	{
-		if (!(fp = fopen(file, "wb")))
-			goto _error;
-
 		for (int i = 0; svars[i].ptr; i++)
 		{
 			uint32_t d = 0;
@@ -782,9 +1018,6 @@ static int do_save_load(const char *file, bool save)
 	}
 	else
 	{
-		if (!(fp = fopen(file, "rb")))
-			goto _error;
-
 		for (int i = 0; blocks[i].ptr != NULL; i++)
 		{
 			if (fread(blocks[i].ptr, 4096, blocks[i].len, fp) < 1)
@@ -829,8 +1062,10 @@ static int do_save_load(const char *file, bool save)
 		memcpy(hw.oam, buf + 0xF00, 256);
 		memcpy(hw.snd->wave, buf + 0xCF0, 16);
 
-		// Disable BIOS. This is a hack to support old saves
-		R_BIOS = 0x1;
+		// Disable BIOS. This is a hack to support old saves, but we must not do it if the state was
+		// taken while the BIOS was running (rewind and run-ahead take states from the very first frame)
+		if (!hw.bios || W(hw.cpu->pc) >= 0x900)
+			R_BIOS = 0x1;
 
 		// Older saves might overflow this
 		cart.rambank &= (cart.ramsize - 1);
@@ -840,26 +1075,52 @@ static int do_save_load(const char *file, bool save)
 		gb_hw_updatemap();
 	}
 
-	fclose(fp);
 	free(buf);
 
 	return 0;
 
 _error:
-	if (fp) fclose(fp);
-	if (buf) free(buf);
+	free(buf);
 
 	return -1;
 }
 
 
+int gnuboy_save_state_fp(FILE *fp)
+{
+	return do_save_load(fp, true);
+}
+
+
+int gnuboy_load_state_fp(FILE *fp)
+{
+	return do_save_load(fp, false);
+}
+
+
 int gnuboy_save_state(const char *file)
 {
-	return do_save_load(file, true);
+	FILE *fp = fopen(file, "wb");
+	if (!fp)
+		return -1;
+
+	int ret = do_save_load(fp, true);
+
+	if (fclose(fp) != 0)
+		ret = -1;
+
+	return ret;
 }
 
 
 int gnuboy_load_state(const char *file)
 {
-	return do_save_load(file, false);
+	FILE *fp = fopen(file, "rb");
+	if (!fp)
+		return -1;
+
+	int ret = do_save_load(fp, false);
+	fclose(fp);
+
+	return ret;
 }
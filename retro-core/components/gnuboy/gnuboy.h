@@ -97,6 +97,18 @@ typedef enum
 	GB_AUDIO_MONO_S16,
 } gb_audio_fmt_t;
 
+typedef struct
+{
+	int loaded;             // Banks currently in memory
+	int budget;             // Max banks in memory
+	unsigned hits;          // Bank switches to a bank already in memory
+	unsigned misses;        // Bank switches that had to read from the file
+	unsigned evictions;
+	unsigned prefetches;    // Banks loaded in the background
+	unsigned readTime;      // Time spent waiting for bank reads (us)
+	unsigned maxReadTime;   // Longest stall (us)
+} gb_bank_counters_t;
+
 typedef void (gb_video_cb_t)(void *buffer);
 typedef void (gb_audio_cb_t)(void *buffer, size_t length);
 
@@ -109,6 +121,8 @@ void gnuboy_reset(bool hard);
 void gnuboy_run(bool draw);
 bool gnuboy_sram_dirty(void);
 void gnuboy_load_bank(int);
+void gnuboy_set_bank_cache(int budget, bool prefetch);
+gb_bank_counters_t gnuboy_get_bank_counters(void);
 void gnuboy_set_pad(int);
 
 void gnuboy_set_framebuffer(void *buffer);
@@ -125,3 +139,5 @@ int gnuboy_load_sram(const char *file);
 int gnuboy_save_sram(const char *file, bool quick_save);
 int gnuboy_load_state(const char *file);
 int gnuboy_save_state(const char *file);
+int gnuboy_load_state_fp(FILE *fp);
+int gnuboy_save_state_fp(FILE *fp);
@@ -288,7 +288,7 @@ void gb_hw_updatemap(void)
 {
 	int rombank = cart.rombank & (cart.romsize - 1);
 
-	if (cart.rombanks[rombank] == NULL)
+	if (rombank != cart.mappedbank || cart.rombanks[rombank] == NULL)
 	{
 		gnuboy_load_bank(rombank);
 	}
@@ -182,6 +182,10 @@ typedef struct
 
 	// Memory
 	byte **rombanks; // [512];
+	uint32_t *bankstamps; // Last time each bank was mapped, for LRU eviction
+	uint32_t bankclock;
+	int mappedbank;
+	gb_bank_counters_t bankstats;
 	byte (*rambanks)[8192];
 	unsigned sram_dirty;
 	unsigned sram_saved;
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Runs the blargg test ROMs headless and compares the output with the golden files, then checks the OSD.
+# Usage: run.sh <path to the SDL2 retro-core binary> [--record]
+# With --record the golden files are rewritten instead (check the diff before committing!). Without it a
+# missing golden file is a failure, rg_bench would otherwise record it and the run would pass.
+set -e
+
+BINARY=$(realpath "$1")
+HERE=$(dirname "$(realpath "$0")")
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+unzip -q "$HERE/../blargg.zip" -d "$WORKDIR"
+cd "$WORKDIR"
+
+# rom, core, frames (a bit past the point where the test prints its result)
+TESTS="
+cpu_instrs/cpu_instrs.gb gbc 2400
+instr_timing/instr_timing.gb gbc 1200
+mem_timing/mem_timing.gb gbc 900
+mem_timing-2/mem_timing.gb gbc 900
+oam_bug/oam_bug.gb gb 600
+halt_bug.gb gb 300
+interrupt_time/interrupt_time.gb gbc 300
+dmg_sound/dmg_sound.gb gb 900
+cgb_sound/cgb_sound.gb gbc 900
+"
+
+# run_test <rom> <core> <frames> <golden> [extra environment...]
+run_test() {
+    rom=$1 core=$2 frames=$3 golden=$4
+    shift 4
+    if [ "$RECORD" = "--record" ]; then
+        rm -f "$golden"
+        expected="golden file recorded"
+    elif [ ! -f "$golden" ]; then
+        echo "FAIL $(basename "$golden" .txt): missing $golden"
+        exit 1
+    else
+        expected="golden file matched"
+    fi
+    result=$(env "$@" RG_BENCH_CORE=$core RG_BENCH_ROM=$rom RG_BENCH_FRAMES=$frames RG_BENCH_HASH=$HASH \
+        RG_BENCH_INPUT="$HERE/blargg.input" RG_BENCH_GOLDEN="$golden" "$BINARY" | grep -o "RG_BENCH \(golden\|mismatch\).*") || true
+    case "$result" in
+        *"$expected"*) echo "PASS $(basename "$golden" .txt)";;
+        *) echo "FAIL $(basename "$golden" .txt): ${result:-crashed}"; exit 1;;
+    esac
+}
+
+RECORD=$2
+HASH=60
+
+echo "$TESTS" | while read -r rom core frames; do
+    [ -n "$rom" ] || continue
+    run_test "$rom" "$core" "$frames" "$HERE/golden/$(echo "${rom%.gb}" | tr '/' '_').txt"
+done
+
+# The OSD over a static screen, hashing what the emulated LCD shows: drawn in the middle of the viewport at 150,
+# partly changed at 300, cleared at 450 and drawn in the top left corner at 600. Each change must be on screen at
+# the next hash, and once cleared the screen must be back to what it was (the lines under it were sent again).
+HASH=30
+golden="$HERE/golden/osd_halt_bug.txt"
+run_test halt_bug.gb gb 720 "$golden" RG_BENCH_LCD=1 RG_BENCH_OSD=150
+lcd_hash() { grep "^$1 " "$golden" | cut -d' ' -f2; }
+if [ "$(lcd_hash 150)" = "$(lcd_hash 180)" ] || [ "$(lcd_hash 180)" = "$(lcd_hash 330)" ] \
+    || [ "$(lcd_hash 150)" != "$(lcd_hash 480)" ] || [ "$(lcd_hash 480)" = "$(lcd_hash 630)" ]; then
+    echo "FAIL osd: $golden doesn't show the expected changes"
+    exit 1
+fi
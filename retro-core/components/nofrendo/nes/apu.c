@@ -22,6 +22,7 @@
 */
 
 #include "nes.h"
+#include <math.h>
 
 #define APU_VOLUME_DECAY(x)  ((x) -= ((x) >> 7))
 
@@ -75,6 +76,83 @@ static const int dmc_clocks[16] =
 /* ratios of pos/neg pulse for rectangle waves */
 static const int duty_flip[4] = { 2, 4, 8, 12 };
 
+/* band-limited step kernels (windowed sinc impulses), one per sub-sample phase, Q15 */
+static int16 blip_kernel[APU_BLIP_PHASES][APU_BLIP_WIDTH];
+
+#define BLIP_ENABLED() (OPT(APU_SYNTH_TYPE) == APU_SYNTH_BLEP)
+
+
+static void apu_blip_build_kernel(void)
+{
+   const float cutoff = 0.45f; /* of the sample rate, a bit below nyquist */
+
+   for (int phase = 0; phase < APU_BLIP_PHASES; phase++)
+   {
+      /* the step is centered between the two middle taps, plus its sub-sample phase */
+      float center = (APU_BLIP_WIDTH / 2 - 1) + (float)phase / APU_BLIP_PHASES;
+      float taps[APU_BLIP_WIDTH], sum = 0;
+      int total = 0, largest = 0;
+
+      for (int i = 0; i < APU_BLIP_WIDTH; i++)
+      {
+         float x = i - center;
+         float w = MAX(0.f, MIN((x + APU_BLIP_WIDTH / 2) / APU_BLIP_WIDTH, 1.f)); /* blackman window */
+         float sinc = (x == 0) ? 1.f : sinf(M_PI * 2 * cutoff * x) / (M_PI * 2 * cutoff * x);
+         taps[i] = sinc * (0.42f - 0.5f * cosf(2 * M_PI * w) + 0.08f * cosf(4 * M_PI * w));
+         sum += taps[i];
+      }
+
+      /* each kernel must sum to exactly 1.0 or the integrator will drift */
+      for (int i = 0; i < APU_BLIP_WIDTH; i++)
+      {
+         blip_kernel[phase][i] = (int16)(taps[i] / sum * 0x8000);
+         total += blip_kernel[phase][i];
+         if (blip_kernel[phase][i] > blip_kernel[phase][largest])
+            largest = i;
+      }
+      blip_kernel[phase][largest] += 0x8000 - total;
+   }
+}
+
+/* the level of a channel at the start of the current sample, returns the change to apply there without
+** band-limiting it. Those are the slow changes (envelopes, decay, averaged noise) that happen on sample
+** boundaries anyway.
+*/
+static inline int apu_blip_level(int chan, int level)
+{
+   int delta = level - apu.blip.level[chan];
+   apu.blip.level[chan] = level;
+   return delta;
+}
+
+/* record a change of level of a channel, cycles is the time into the current sample */
+static inline void apu_blip_step(int chan, int level, float cycles)
+{
+   int delta = level - apu.blip.level[chan];
+
+   if (delta == 0)
+      return;
+
+   apu.blip.level[chan] = level;
+
+   int offset = (int)(cycles * apu.blip.factor);
+   offset = MAX(0, MIN(offset, 0xFFFF));
+
+   int32 *out = apu.blip.buffer + apu.blip.sample;
+   const int16 *kernel = blip_kernel[offset >> (16 - APU_BLIP_PHASE_BITS)];
+   int total = 0;
+
+   for (int i = 0; i < APU_BLIP_WIDTH; i++)
+   {
+      int value = (kernel[i] * delta) >> 7; /* Q15 to Q8 */
+      out[i] += value;
+      total += value;
+   }
+
+   /* rounding errors would accumulate in the integrator */
+   out[APU_BLIP_WIDTH / 2] += delta * 256 - total;
+}
+
 
 void apu_fc_advance(int cycles)
 {
@@ -134,7 +212,7 @@ static void apu_build_luts(int num_samples)
 #define  APU_MAKE_RECTANGLE(ch) \
 static inline int apu_rectangle_##ch(void) \
 { \
-   int output, total, num_times; \
+   int output, total, num_times, level = 0; \
 \
    APU_VOLUME_DECAY(apu.rectangle[ch].output_vol); \
 \
@@ -198,18 +276,21 @@ static inline int apu_rectangle_##ch(void) \
 \
    while (apu.rectangle[ch].accum < 0) \
    { \
+      float cycles = apu.rectangle[ch].accum + apu.cycle_rate; \
       apu.rectangle[ch].accum += apu.rectangle[ch].freq + 1; \
       apu.rectangle[ch].adder = (apu.rectangle[ch].adder + 1) & 0x0F; \
 \
-      if (apu.rectangle[ch].adder < apu.rectangle[ch].duty_flip) \
-         total += output; \
-      else \
-         total -= output; \
+      level = (apu.rectangle[ch].adder < apu.rectangle[ch].duty_flip) ? output : -output; \
+      total += level; \
+\
+      if (BLIP_ENABLED()) \
+         apu_blip_step(ch, level, cycles); \
 \
       num_times++; \
    } \
 \
-   apu.rectangle[ch].output_vol = total / num_times; \
+   /* band-limited steps don't need the averaging, the last level is current */ \
+   apu.rectangle[ch].output_vol = BLIP_ENABLED() ? level : total / num_times; \
    return apu.rectangle[ch].output_vol; \
 }
 
@@ -248,8 +329,11 @@ static inline int apu_triangle(void)
       goto output;
 
    apu.triangle.accum -= apu.cycle_rate; \
+   int num_times = 0;
+   float cycles = 0;
    while (apu.triangle.accum < 0)
    {
+      cycles = apu.triangle.accum + apu.cycle_rate;
       apu.triangle.accum += apu.triangle.freq;
       apu.triangle.adder = (apu.triangle.adder + 1) & 0x1F;
 
@@ -257,8 +341,16 @@ static inline int apu_triangle(void)
          apu.triangle.output_vol -= (2 << 8);
       else
          apu.triangle.output_vol += (2 << 8);
+
+      num_times++;
    }
 
+   /* several steps within one sample (high notes) aren't worth band-limiting one by one, they're
+   ** applied at the start of the sample instead
+   */
+   if (BLIP_ENABLED() && num_times == 1)
+      apu_blip_step(2, apu.triangle.output_vol + (apu.triangle.output_vol >> 2), cycles);
+
 output:
    return (apu.triangle.output_vol + (apu.triangle.output_vol >> 2));
 }
@@ -275,6 +367,7 @@ static inline int apu_noise(void)
    int outvol = 0;
    int num_times = 0;
    int total = 0;
+   float cycles = 0;
 
    APU_VOLUME_DECAY(apu.noise.output_vol);
 
@@ -317,14 +410,22 @@ static inline int apu_noise(void)
       int tap = (sreg & apu.noise.xor_tap) ? 1 : 0;
       int bit0 = sreg & 1;
       int bit14 = (bit0 ^ tap);
+      int level = (bit0 ^ 1) ? outvol : -outvol;
 
-      total += (bit0 ^ 1) ? outvol : -outvol;
+      total += level;
       num_times++;
+      cycles = apu.noise.accum + apu.cycle_rate;
 
       apu.noise.shift_reg = (bit14 << 14) | (sreg >> 1);
       apu.noise.accum += apu.noise.freq;
    }
 
+   /* noise faster than the output rate is averaged like in the naive synth, band-limiting every
+   ** step would cost a lot for no audible difference. It's applied at the start of the sample.
+   */
+   if (BLIP_ENABLED() && num_times == 1)
+      apu_blip_step(3, (total + total + total) >> 2, cycles);
+
    outvol = total / num_times;
 
    apu.noise.output_vol = outvol;
@@ -359,6 +460,7 @@ static inline int apu_dmc(void)
 
       while (apu.dmc.accum < 0)
       {
+         float cycles = apu.dmc.accum + apu.cycle_rate;
          apu.dmc.accum += apu.dmc.freq;
 
          int delta_bit = (apu.dmc.dma_length & 7) ^ 7;
@@ -417,6 +519,9 @@ static inline int apu_dmc(void)
                apu.dmc.output_vol -= (2 << 8);
             }
          }
+
+         if (BLIP_ENABLED())
+            apu_blip_step(4, (apu.dmc.output_vol + apu.dmc.output_vol + apu.dmc.output_vol) >> 2, cycles);
       }
    }
 
@@ -675,6 +780,54 @@ uint8 apu_read(uint32 address)
    return value;
 }
 
+/* Same as apu_process but the channels' steps are rendered through band-limited steps at
+** their exact position within the sample, instead of being point sampled and filtered.
+*/
+static void apu_process_blep(short *buffer, size_t num_samples, bool stereo)
+{
+   int32 integrator = apu.blip.integrator;
+
+   for (size_t i = 0; i < num_samples; i++)
+   {
+      apu.blip.sample = i;
+
+      /* steps within the sample are recorded by the channels, this catches everything
+      ** else (envelopes, decay, silencing) at the start of the sample
+      */
+      int delta = apu_blip_level(0, apu_rectangle_0());
+      delta += apu_blip_level(1, apu_rectangle_1());
+      delta += apu_blip_level(2, apu_triangle());
+      delta += apu_blip_level(3, apu_noise());
+      delta += apu_blip_level(4, apu_dmc());
+      if (apu.ext)
+         delta += apu_blip_level(5, apu.ext->process());
+      apu.blip.buffer[i + APU_BLIP_WIDTH / 2] += delta * 256;
+
+      /* steps only ever land on the current sample or later ones, this one is complete */
+      integrator += apu.blip.buffer[i];
+
+      int accum = integrator >> 8;
+
+      /* do clipping */
+      if (accum > 0x7FFF)
+         accum = 0x7FFF;
+      else if (accum < -0x8000)
+         accum = -0x8000;
+
+      /* signed 16-bit output */
+      *buffer++ = (short) accum;
+
+      if (stereo)
+         *buffer++ = (short) accum;
+   }
+
+   /* the kernels' tails belong to the next frame */
+   memmove(apu.blip.buffer, apu.blip.buffer + num_samples, APU_BLIP_WIDTH * sizeof(int32));
+   memset(apu.blip.buffer + APU_BLIP_WIDTH, 0, num_samples * sizeof(int32));
+
+   apu.blip.integrator = integrator;
+}
+
 void apu_process(short *buffer, size_t num_samples, bool stereo)
 {
    int prev_sample = apu.prev_sample;
@@ -682,6 +835,12 @@ void apu_process(short *buffer, size_t num_samples, bool stereo)
    if (!buffer)
       return;
 
+   if (BLIP_ENABLED())
+   {
+      apu_process_blep(buffer, num_samples, stereo);
+      return;
+   }
+
    while (num_samples--)
    {
       int accum = 0;
@@ -741,6 +900,19 @@ void apu_setopt(apu_option_t n, int val)
    // Some options need special care
    switch (n)
    {
+      case APU_SYNTH_TYPE:
+         free(apu.blip.buffer);
+         memset(&apu.blip.level, 0, sizeof(apu.blip.level));
+         apu.blip.integrator = 0;
+         apu.blip.buffer = NULL;
+         if (val == APU_SYNTH_BLEP)
+         {
+            apu.blip.buffer = calloc(apu.sample_rate / 50 + 2 + APU_BLIP_WIDTH, sizeof(int32));
+            if (!apu.blip.buffer)
+               val = APU_SYNTH_NAIVE;
+         }
+      break;
+
       default:
       break;
    }
@@ -759,6 +931,7 @@ void apu_reset(void)
    nes_t *nes = nes_getptr();
    apu.samples_per_frame = apu.sample_rate / nes->refresh_rate;
    apu.cycle_rate = (float)nes->cpu_clock / apu.sample_rate;
+   apu.blip.factor = 65536.f / apu.cycle_rate;
    apu.noise.shift_reg = 0x4000;
    apu_build_luts(apu.samples_per_frame);
 
@@ -789,6 +962,9 @@ apu_t *apu_init(int sample_rate, bool stereo)
    apu_setopt(APU_CHANNEL4_EN, true);
    apu_setopt(APU_CHANNEL5_EN, true);
    apu_setopt(APU_CHANNEL6_EN, true);
+   apu_setopt(APU_SYNTH_TYPE, APU_SYNTH_NAIVE);
+
+   apu_blip_build_kernel();
 
    return &apu;
 }
@@ -797,6 +973,8 @@ void apu_shutdown(void)
 {
    free(apu.buffer);
    apu.buffer = NULL;
+   free(apu.blip.buffer);
+   apu.blip.buffer = NULL;
 }
 
 void apu_setext(const apuext_t *ext)
@@ -157,6 +157,17 @@ enum
    APU_FILTER_WEIGHTED
 };
 
+enum
+{
+   APU_SYNTH_NAIVE, /* channels are sampled once per output sample, then filtered */
+   APU_SYNTH_BLEP,  /* amplitude steps are rendered through band-limited steps */
+};
+
+/* band-limited step kernel: taps per step, and sub-sample resolution */
+#define  APU_BLIP_WIDTH       8
+#define  APU_BLIP_PHASE_BITS  5
+#define  APU_BLIP_PHASES      (1 << APU_BLIP_PHASE_BITS)
+
 /* external sound chip stuff */
 typedef struct
 {
@@ -173,6 +184,7 @@ typedef enum
    APU_CHANNEL4_EN,
    APU_CHANNEL5_EN,
    APU_CHANNEL6_EN,
+   APU_SYNTH_TYPE,
 } apu_option_t;
 
 typedef struct
@@ -193,6 +205,15 @@ typedef struct
 
    float cycle_rate;
 
+   /* band-limited synthesis state, see APU_SYNTH_BLEP */
+   struct {
+      int32 *buffer;  /* amplitude deltas, Q8, one frame + kernel width */
+      int32 integrator;
+      int level[6];   /* level of each channel already in the buffer */
+      float factor;   /* APU cycles to Q16 sample fraction */
+      int sample;     /* index of the sample being generated */
+   } blip;
+
    struct {
       unsigned state;
       unsigned step;
@@ -32,6 +32,7 @@ void mmc_bankprg(unsigned size, unsigned address, int bank, uint8 *base)
 {
    // ASSERT(size == 8 || size == 16 || size == 32);
    int banks = 16;
+   void *pager = NULL;
 
    // if (base == PRG_ANY)
    //    base = cart->prg_rom_banks ? PRG_ROM : PRG_RAM;
@@ -40,6 +41,9 @@ void mmc_bankprg(unsigned size, unsigned address, int bank, uint8 *base)
    {
       base = cart->prg_rom;
       banks = cart->prg_rom_banks;
+#ifdef RETRO_GO
+      pager = cart->prg_pager;
+#endif
    }
    else if (base == PRG_RAM)
    {
@@ -52,7 +56,7 @@ void mmc_bankprg(unsigned size, unsigned address, int bank, uint8 *base)
    if (bank < 0)
       bank += banks;
 
-   if (base == NULL || banks == 0 || bank < 0) // || bank > banks)
+   if ((base == NULL && pager == NULL) || banks == 0 || bank < 0) // || bank > banks)
    {
       MESSAGE_ERROR("MMC: Bogus PRG mapping! Address: $%04X, Size: %dKB, Bank: %d, Banks: %d, Base: %p\n",
          address, size, bank, banks, base);
@@ -60,6 +64,21 @@ void mmc_bankprg(unsigned size, unsigned address, int bank, uint8 *base)
    }
 
    bank %= banks;
+
+#ifdef RETRO_GO
+   // Paged PRG-ROM: each 8KB CPU window is a pager slot, the page stays resident while it's mapped
+   if (pager)
+   {
+      for (size_t i = 0, num = (size * 1024 / MEM_PAGESIZE); i < num; ++i)
+      {
+         unsigned page_address = address + i * MEM_PAGESIZE;
+         uint8 *page = rg_pager_map(pager, (page_address >> 13) & 7, bank * (size * 1024) + i * MEM_PAGESIZE);
+         mem_setpage(page_address >> MEM_PAGESHIFT, page);
+      }
+      return;
+   }
+#endif
+
    base += bank * (size * 1024);
 
    for (size_t i = 0, num = (size * 1024 / MEM_PAGESIZE); i < num; ++i)
@@ -92,13 +92,11 @@ void nes_settimer(nes_timer_t *func, int period)
     nes.timer_period = period;
 }
 
-/* insert a cart into the NES */
-int nes_insertcart(const char *filename, const char *biosfile)
+/* set up the machine for the cart in nes.cart */
+static int nes_setupcart(const char *biosfile)
 {
     int status = 0;
 
-    /* rom file */
-    nes.cart = rom_loadfile(filename);
     if (NULL == nes.cart)
     {
         status = -1;
@@ -176,6 +174,29 @@ _fail:
     return status;
 }
 
+/* insert a cart into the NES */
+int nes_insertcart(const char *filename, const char *biosfile)
+{
+    nes.cart = rom_loadfile(filename);
+    return nes_setupcart(biosfile);
+}
+
+/* insert a cart that is already in memory, data is owned by the cart from now on */
+int nes_insertimage(uint8 *data, size_t size, const char *filename, const char *biosfile)
+{
+    nes.cart = rom_loadimage(data, size, filename);
+    return nes_setupcart(biosfile);
+}
+
+#ifdef RETRO_GO
+/* insert a cart whose PRG-ROM stays on the disk and is paged in as needed */
+int nes_insertpaged(const char *filename)
+{
+    nes.cart = rom_loadpaged(filename);
+    return nes_setupcart(NULL);
+}
+#endif
+
 /* insert a disk into the FDS */
 int nes_insertdisk(const char *filename, const char *biosfile)
 {
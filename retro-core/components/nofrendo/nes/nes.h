@@ -116,6 +116,10 @@ nes_t *nes_init(nes_type_t system, int sample_rate, bool stereo);
 uint8 *nes_setvidbuf(uint8 *vidbuf);
 void nes_shutdown(void);
 int nes_insertcart(const char *filename, const char *biosfile);
+int nes_insertimage(uint8 *data, size_t size, const char *filename, const char *biosfile);
+#ifdef RETRO_GO
+int nes_insertpaged(const char *filename);
+#endif
 int nes_insertdisk(const char *filename, const char *biosfile);
 void nes_settimer(nes_timer_t *func, int period);
 void nes_emulate(bool draw);
@@ -64,6 +64,103 @@ static void rom_loadsram(void)
 }
 #endif
 
+/* Parse an iNES header, rom.prg_rom/chr_rom/checksum must already be set */
+static bool rom_setupines(const inesheader_t *header)
+{
+   rom.prg_rom_banks = header->prg_banks * 2;
+   rom.chr_rom_banks = header->chr_banks;
+   rom.prg_ram_banks = 1; // 8KB. Not specified by iNES
+   rom.chr_ram_banks = 1; // 8KB. Not specified by iNES
+   rom.flags = header->rom_type;
+   rom.mapper_number = header->rom_type >> 4;
+
+   MESSAGE_INFO("ROM: CRC32:  %08X\n", (unsigned)rom.checksum);
+
+   if (header->reserved2 == 0)
+   {
+      // https://wiki.nesdev.com/w/index.php/INES
+      // A general rule of thumb: if the last 4 bytes are not all zero, and the header is
+      // not marked for NES 2.0 format, an emulator should either mask off the upper 4 bits
+      // of the mapper number or simply refuse to load the ROM.
+      rom.mapper_number |= (header->mapper_hinybble & 0xF0);
+   }
+
+   if (rom.flags & ROM_FLAG_FOURSCREEN)
+      rom.mirroring = PPU_MIRROR_FOUR;
+   else if (rom.flags & ROM_FLAG_VERTICAL)
+      rom.mirroring = PPU_MIRROR_VERT;
+
+   const db_game_t *entry = games_database;
+   while (entry->crc && entry->crc != rom.checksum)
+      entry++;
+
+   if (entry->crc == rom.checksum)
+   {
+      MESSAGE_INFO("ROM: Game found in database.\n");
+
+      rom.system = entry->system;
+
+      if (entry->mapper != rom.mapper_number)
+      {
+         MESSAGE_WARN("ROM: mapper mismatch! (DB: %d, ROM: %d)\n", entry->mapper, rom.mapper_number);
+         rom.mapper_number = entry->mapper;
+      }
+
+      if (entry->mirror != rom.mirroring)
+      {
+         MESSAGE_WARN("ROM: mirroring mismatch! (DB: %d, ROM: %d)\n", entry->mirror, rom.mirroring);
+         rom.mirroring = entry->mirror;
+      }
+
+      if (entry->prg_rom != rom.prg_rom_banks)
+      {
+         MESSAGE_WARN("ROM: prg_rom_banks mismatch! (DB: %d, ROM: %d)\n", entry->prg_rom, rom.prg_rom_banks);
+         // rom.prg_rom_banks = entry->prg_rom;
+      }
+
+      if (entry->prg_ram != rom.prg_ram_banks)
+      {
+         MESSAGE_WARN("ROM: prg_ram_banks mismatch! (DB: %d, ROM: %d)\n", entry->prg_ram, rom.prg_ram_banks);
+         // rom.prg_ram_banks = entry->prg_ram;
+      }
+
+      if (entry->chr_rom > -1 && entry->chr_rom != rom.chr_rom_banks)
+      {
+         MESSAGE_WARN("ROM: chr_rom_banks mismatch! (DB: %d, ROM: %d)\n", entry->chr_rom, rom.chr_rom_banks);
+         // rom.chr_rom_banks = entry->chr_rom;
+      }
+
+      if (entry->chr_ram > -1 && entry->chr_ram != rom.chr_ram_banks)
+      {
+         MESSAGE_WARN("ROM: chr_ram_banks mismatch! (DB: %d, ROM: %d)\n", entry->chr_ram, rom.chr_ram_banks);
+         // rom.chr_ram_banks = entry->chr_ram;
+      }
+   }
+   else
+   {
+      MESSAGE_INFO("ROM: Game not found in database.\n");
+   }
+
+   rom.prg_ram = malloc(rom.prg_ram_banks * ROM_PRG_BANK_SIZE);
+   rom.chr_ram = malloc(rom.chr_ram_banks * ROM_CHR_BANK_SIZE);
+
+   if (!rom.prg_ram || !rom.chr_ram)
+   {
+      MESSAGE_ERROR("ROM: Memory allocation failed!\n");
+      return false;
+   }
+
+   MESSAGE_INFO("ROM: Mapper: %d, PRG:%dK, CHR:%dK, Flags: %c%c%c%c\n",
+               rom.mapper_number,
+               rom.prg_rom_banks * 8, rom.chr_rom_banks * 8,
+               (rom.flags & ROM_FLAG_VERTICAL) ? 'V' : 'H',
+               (rom.flags & ROM_FLAG_BATTERY) ? 'B' : '-',
+               (rom.flags & ROM_FLAG_TRAINER) ? 'T' : '-',
+               (rom.flags & ROM_FLAG_FOURSCREEN) ? '4' : '-');
+
+   return true;
+}
+
 /* Load a ROM from a memory buffer */
 rom_t *rom_loadmem(uint8 *data, size_t size)
 {
@@ -92,101 +189,14 @@ rom_t *rom_loadmem(uint8 *data, size_t size)
       }
 
       rom.checksum = CRC32(0, rom.prg_rom, size - (rom.prg_rom - data));
-      rom.prg_rom_banks = header->prg_banks * 2;
-      rom.chr_rom_banks = header->chr_banks;
-      rom.prg_ram_banks = 1; // 8KB. Not specified by iNES
-      rom.chr_ram_banks = 1; // 8KB. Not specified by iNES
-      rom.flags = header->rom_type;
-      rom.mapper_number = header->rom_type >> 4;
-
-      MESSAGE_INFO("ROM: CRC32:  %08X\n", (unsigned)rom.checksum);
 
-      if (header->reserved2 == 0)
+      if (header->chr_banks > 0)
       {
-         // https://wiki.nesdev.com/w/index.php/INES
-         // A general rule of thumb: if the last 4 bytes are not all zero, and the header is
-         // not marked for NES 2.0 format, an emulator should either mask off the upper 4 bits
-         // of the mapper number or simply refuse to load the ROM.
-         rom.mapper_number |= (header->mapper_hinybble & 0xF0);
+         rom.chr_rom = rom.prg_rom + (header->prg_banks * 2 * ROM_PRG_BANK_SIZE);
       }
 
-      if (rom.flags & ROM_FLAG_FOURSCREEN)
-         rom.mirroring = PPU_MIRROR_FOUR;
-      else if (rom.flags & ROM_FLAG_VERTICAL)
-         rom.mirroring = PPU_MIRROR_VERT;
-
-      const db_game_t *entry = games_database;
-      while (entry->crc && entry->crc != rom.checksum)
-         entry++;
-
-      if (entry->crc == rom.checksum)
-      {
-         MESSAGE_INFO("ROM: Game found in database.\n");
-
-         rom.system = entry->system;
-
-         if (entry->mapper != rom.mapper_number)
-         {
-            MESSAGE_WARN("ROM: mapper mismatch! (DB: %d, ROM: %d)\n", entry->mapper, rom.mapper_number);
-            rom.mapper_number = entry->mapper;
-         }
-
-         if (entry->mirror != rom.mirroring)
-         {
-            MESSAGE_WARN("ROM: mirroring mismatch! (DB: %d, ROM: %d)\n", entry->mirror, rom.mirroring);
-            rom.mirroring = entry->mirror;
-         }
-
-         if (entry->prg_rom != rom.prg_rom_banks)
-         {
-            MESSAGE_WARN("ROM: prg_rom_banks mismatch! (DB: %d, ROM: %d)\n", entry->prg_rom, rom.prg_rom_banks);
-            // rom.prg_rom_banks = entry->prg_rom;
-         }
-
-         if (entry->prg_ram != rom.prg_ram_banks)
-         {
-            MESSAGE_WARN("ROM: prg_ram_banks mismatch! (DB: %d, ROM: %d)\n", entry->prg_ram, rom.prg_ram_banks);
-            // rom.prg_ram_banks = entry->prg_ram;
-         }
-
-         if (entry->chr_rom > -1 && entry->chr_rom != rom.chr_rom_banks)
-         {
-            MESSAGE_WARN("ROM: chr_rom_banks mismatch! (DB: %d, ROM: %d)\n", entry->chr_rom, rom.chr_rom_banks);
-            // rom.chr_rom_banks = entry->chr_rom;
-         }
-
-         if (entry->chr_ram > -1 && entry->chr_ram != rom.chr_ram_banks)
-         {
-            MESSAGE_WARN("ROM: chr_ram_banks mismatch! (DB: %d, ROM: %d)\n", entry->chr_ram, rom.chr_ram_banks);
-            // rom.chr_ram_banks = entry->chr_ram;
-         }
-      }
-      else
-      {
-         MESSAGE_INFO("ROM: Game not found in database.\n");
-      }
-
-      rom.prg_ram = malloc(rom.prg_ram_banks * ROM_PRG_BANK_SIZE);
-      rom.chr_ram = malloc(rom.chr_ram_banks * ROM_CHR_BANK_SIZE);
-
-      if (!rom.prg_ram || !rom.chr_ram)
-      {
-         MESSAGE_ERROR("ROM: Memory allocation failed!\n");
+      if (!rom_setupines(header))
          return NULL;
-      }
-
-      if (rom.chr_rom_banks > 0)
-      {
-         rom.chr_rom = rom.prg_rom + (rom.prg_rom_banks * ROM_PRG_BANK_SIZE);
-      }
-
-      MESSAGE_INFO("ROM: Mapper: %d, PRG:%dK, CHR:%dK, Flags: %c%c%c%c\n",
-                  rom.mapper_number,
-                  rom.prg_rom_banks * 8, rom.chr_rom_banks * 8,
-                  (rom.flags & ROM_FLAG_VERTICAL) ? 'V' : 'H',
-                  (rom.flags & ROM_FLAG_BATTERY) ? 'B' : '-',
-                  (rom.flags & ROM_FLAG_TRAINER) ? 'T' : '-',
-                  (rom.flags & ROM_FLAG_FOURSCREEN) ? '4' : '-');
 
       strcpy(rom.filename, "filename.nes");
       return &rom;
@@ -250,7 +260,133 @@ rom_t *rom_loadmem(uint8 *data, size_t size)
    return NULL;
 }
 
+/* Finish loading, data_ptr now belongs to the cart */
+static rom_t *rom_finishload(const char *filename)
+{
+   if (rom.system == SYS_UNKNOWN && filename)
+   {
+      if (strstr(filename, "(E)")
+         || strstr(filename, "(Europe)")
+         || strstr(filename, "(A)")
+         || strstr(filename, "(Australia)"))
+         rom.system = SYS_NES_PAL;
+   }
+   rom.flags |= ROM_FLAG_FREE_DATA;
+   // This is fine, the loaders zero `rom`.
+   if (filename)
+      strncpy(rom.filename, filename, sizeof(rom.filename) - 1);
+   #ifdef USE_SRAM_FILE
+      rom_loadsram();
+   #endif
+   return &rom;
+}
+
 /* Load a ROM from file */
+/* Load a ROM image, we take ownership of data (it's freed by rom_free, or now on failure) */
+rom_t *rom_loadimage(uint8 *data, size_t size, const char *filename)
+{
+   if (size < 16 || size > 0x200000)
+   {
+      MESSAGE_ERROR("ROM: File size error\n");
+   }
+   else if (rom_loadmem(data, size) == NULL)
+   {
+      MESSAGE_ERROR("ROM: Load error\n");
+   }
+   else
+   {
+      return rom_finishload(filename);
+   }
+
+   free(data);
+   return NULL;
+}
+
+#ifdef RETRO_GO
+/* Load an iNES ROM but leave its PRG-ROM on the disk, mmc_bankprg pages it in as needed */
+rom_t *rom_loadpaged(const char *filename)
+{
+   inesheader_t header;
+   uint8 *buffer = NULL;
+   long size = 0;
+
+   if (!filename)
+      return NULL;
+
+   FILE *fp = fopen(filename, "rb");
+   if (!fp)
+   {
+      MESSAGE_ERROR("ROM: Unable to open file '%s'\n", filename);
+      return NULL;
+   }
+
+   fseek(fp, 0, SEEK_END);
+   size = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+
+   if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, ROM_NES_MAGIC, 4))
+   {
+      MESSAGE_ERROR("ROM: Only iNES files can be paged!\n");
+      fclose(fp);
+      return NULL;
+   }
+
+   size_t prg_offset = sizeof(header) + ((header.rom_type & ROM_FLAG_TRAINER) ? 0x200 : 0);
+   size_t prg_size = header.prg_banks * 2 * ROM_PRG_BANK_SIZE;
+   size_t chr_size = header.chr_banks * ROM_CHR_BANK_SIZE;
+
+   MESSAGE_INFO("ROM: Found iNES file of size %d, PRG-ROM will be paged.\n", (int)size);
+
+   rom = (rom_t) {
+      .system = SYS_UNKNOWN,
+      .mirroring = PPU_MIRROR_HORI,
+   };
+
+   // The checksum covers everything after the header, we stream it to avoid loading the whole file
+   if (!(buffer = malloc(ROM_PRG_BANK_SIZE)))
+      goto _fail;
+
+   fseek(fp, prg_offset, SEEK_SET);
+   for (size_t len; (len = fread(buffer, 1, ROM_PRG_BANK_SIZE, fp)) > 0;)
+      rom.checksum = CRC32(rom.checksum, buffer, len);
+
+   free(buffer);
+   buffer = NULL;
+
+   // CHR-ROM is accessed one byte at a time by the PPU, it stays in memory
+   if (chr_size > 0)
+   {
+      if (!(rom.data_ptr = malloc(chr_size)))
+         goto _fail;
+      rom.data_len = chr_size;
+      rom.chr_rom = rom.data_ptr;
+      fseek(fp, prg_offset + prg_size, SEEK_SET);
+      if (fread(rom.chr_rom, chr_size, 1, fp) != 1)
+         goto _fail;
+   }
+
+   fclose(fp);
+   fp = NULL;
+
+   if (!rom_setupines(&header))
+      goto _fail;
+
+   if (!(rom.prg_pager = rg_pager_open(filename, prg_offset, prg_size, ROM_PRG_BANK_SIZE, 8, 0)))
+      goto _fail;
+
+   return rom_finishload(filename);
+
+_fail:
+   MESSAGE_ERROR("ROM: Load error\n");
+   if (fp)
+      fclose(fp);
+   free(buffer);
+   rom.flags |= ROM_FLAG_FREE_DATA;
+   rom_free();
+   return NULL;
+}
+#endif
+
 rom_t *rom_loadfile(const char *filename)
 {
    uint8 *data = NULL;
@@ -284,28 +420,10 @@ rom_t *rom_loadfile(const char *filename)
    {
       MESSAGE_ERROR("ROM: Read error\n");
    }
-   else if (rom_loadmem(data, size) == NULL)
-   {
-      MESSAGE_ERROR("ROM: Load error\n");
-   }
    else
    {
       fclose(fp);
-      if (rom.system == SYS_UNKNOWN)
-      {
-         if (strstr(filename, "(E)")
-            || strstr(filename, "(Europe)")
-            || strstr(filename, "(A)")
-            || strstr(filename, "(Australia)"))
-            rom.system = SYS_NES_PAL;
-      }
-      rom.flags |= ROM_FLAG_FREE_DATA;
-      // This is fine, rom_loadmem zeroes `rom`.
-      strncpy(rom.filename, filename, sizeof(rom.filename) - 1);
-      #ifdef USE_SRAM_FILE
-         rom_loadsram();
-      #endif
-      return &rom;
+      return rom_loadimage(data, size, filename);
    }
 
    fclose(fp);
@@ -328,4 +446,8 @@ void rom_free(void)
    rom.prg_ram = NULL;
    free(rom.chr_ram);
    rom.chr_ram = NULL;
+#ifdef RETRO_GO
+   rg_pager_close(rom.prg_pager);
+   rom.prg_pager = NULL;
+#endif
 }
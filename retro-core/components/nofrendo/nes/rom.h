@@ -23,6 +23,10 @@
 
 #pragma once
 
+#ifdef RETRO_GO
+#include <rg_pager.h>
+#endif
+
 #define ROM_NES_MAGIC          "NES\x1A"
 #define ROM_NSF_MAGIC          "NESM\x1A"
 #define ROM_FDS_MAGIC          "FDS\x1A"
@@ -86,6 +90,9 @@ typedef struct
    uint8 *chr_rom;
    uint8 *prg_ram;
    uint8 *chr_ram;
+#ifdef RETRO_GO
+   rg_pager_t *prg_pager; // Set if prg_rom is paged in from the disk
+#endif
 
    int prg_rom_banks;
    int chr_rom_banks;
@@ -102,4 +109,8 @@ typedef struct
 
 rom_t *rom_loadfile(const char *filename);
 rom_t *rom_loadmem(uint8 *data, size_t size);
+rom_t *rom_loadimage(uint8 *data, size_t size, const char *filename);
+#ifdef RETRO_GO
+rom_t *rom_loadpaged(const char *filename);
+#endif
 void rom_free(void);
@@ -101,7 +101,8 @@ static bool running = false;
 int
 LoadCard(const char *name)
 {
-	int fsize, offset;
+	uint8_t *data;
+	int fsize;
 
 	MESSAGE_INFO("Opening %s...\n", name);
 
@@ -113,33 +114,55 @@ LoadCard(const char *name)
 		return -1;
 	}
 
-	if (PCE.ROM != NULL) {
-		free(PCE.ROM);
-	}
-
 	// find file size
 	fseek(fp, 0, SEEK_END);
 	fsize = ftell(fp);
-	offset = fsize & 0x1fff;
 
 	// read ROM
-	PCE.ROM = malloc(fsize);
+	data = malloc(fsize);
 
-	if (PCE.ROM == NULL)
+	if (data == NULL)
 	{
 		MESSAGE_ERROR("Failed to allocate ROM buffer!\n");
+		fclose(fp);
 		return -1;
 	}
 
 	fseek(fp, 0, SEEK_SET);
-	fread(PCE.ROM, 1, fsize, fp);
+	fread(data, 1, fsize, fp);
 
 	fclose(fp);
 
-	PCE.ROM_SIZE = (fsize - offset) / 0x2000;
-	PCE.ROM_DATA = PCE.ROM + offset;
-	PCE.ROM_CRC = crc32_le(0, PCE.ROM, fsize);
+	return LoadCardData(data, fsize);
+}
+
+
+static void
+DecryptROM(uint8_t *data, size_t size, void *arg)
+{
+	const unsigned char inverted_nibble[16] = {
+		0, 8, 4, 12, 2, 10, 6, 14,
+		1, 9, 5, 13, 3, 11, 7, 15
+	};
+
+	for (int x = 0; x < size; x++) {
+		unsigned char temp = data[x] & 15;
+
+		data[x] &= ~0x0F;
+		data[x] |= inverted_nibble[data[x] >> 4];
+
+		data[x] &= ~0xF0;
+		data[x] |= inverted_nibble[temp] << 4;
+	}
+}
 
+
+/**
+ * Set the card's memory map, the ROM is either in PCE.ROM_DATA or in PCE.ROM_PAGER
+ */
+static int
+SetupCard(int offset)
+{
 	uint32_t IDX = 0;
 	uint32_t ROM_MASK = 1;
 
@@ -157,25 +180,21 @@ LoadCard(const char *name)
 
 	MESSAGE_INFO("Game Name: %s\n", romFlags[IDX].Name);
 
+	uint8_t reset_bank_end = 0xFF;
+	if (PCE.ROM_PAGER)
+		rg_pager_read(PCE.ROM_PAGER, 0x1FFF, &reset_bank_end, 1);
+	else if (PCE.ROM_SIZE > 0)
+		reset_bank_end = PCE.ROM_DATA[0x1FFF];
+
 	// US Encrypted
-	if ((romFlags[IDX].Flags & US_ENCODED) || PCE.ROM_DATA[0x1FFF] < 0xE0)
+	if ((romFlags[IDX].Flags & US_ENCODED) || reset_bank_end < 0xE0)
 	{
 		MESSAGE_INFO("This rom is probably US encrypted, decrypting...\n");
 
-		unsigned char inverted_nibble[16] = {
-			0, 8, 4, 12, 2, 10, 6, 14,
-			1, 9, 5, 13, 3, 11, 7, 15
-		};
-
-		for (int x = 0; x < PCE.ROM_SIZE * 0x2000; x++) {
-			unsigned char temp = PCE.ROM_DATA[x] & 15;
-
-			PCE.ROM_DATA[x] &= ~0x0F;
-			PCE.ROM_DATA[x] |= inverted_nibble[PCE.ROM_DATA[x] >> 4];
-
-			PCE.ROM_DATA[x] &= ~0xF0;
-			PCE.ROM_DATA[x] |= inverted_nibble[temp] << 4;
-		}
+		if (PCE.ROM_PAGER)
+			rg_pager_set_filter(PCE.ROM_PAGER, DecryptROM, NULL);
+		else
+			DecryptROM(PCE.ROM_DATA, PCE.ROM_SIZE * 0x2000, NULL);
 	}
 
 	// For example with Devil Crush 512Ko
@@ -189,22 +208,22 @@ LoadCard(const char *name)
 			case 0x00:
 			case 0x10:
 			case 0x50:
-				PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
+				pce_rom_bank_set(i, (i & ROM_MASK) * 0x2000);
 				break;
 			case 0x20:
 			case 0x60:
-				PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
+				pce_rom_bank_set(i, ((i - 0x20) & ROM_MASK) * 0x2000);
 				break;
 			case 0x30:
 			case 0x70:
-				PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x10) & ROM_MASK) * 0x2000;
+				pce_rom_bank_set(i, ((i - 0x10) & ROM_MASK) * 0x2000);
 				break;
 			case 0x40:
-				PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
+				pce_rom_bank_set(i, ((i - 0x20) & ROM_MASK) * 0x2000);
 				break;
 			}
 		} else {
-			PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
+			pce_rom_bank_set(i, (i & ROM_MASK) * 0x2000);
 		}
 		PCE.MemoryMapW[i] = PCE.NULLRAM;
 	}
@@ -227,6 +246,79 @@ LoadCard(const char *name)
 }
 
 
+static void
+FreeCard(void)
+{
+	free(PCE.ROM);
+	PCE.ROM = PCE.ROM_DATA = NULL;
+	rg_pager_close(PCE.ROM_PAGER);
+	PCE.ROM_PAGER = NULL;
+}
+
+
+/**
+ * Set the memory map for a card image already in memory, the card takes ownership of data
+ */
+int
+LoadCardData(uint8_t *data, size_t fsize)
+{
+	int offset = fsize & 0x1fff;
+
+	FreeCard();
+
+	PCE.ROM = data;
+	PCE.ROM_SIZE = (fsize - offset) / 0x2000;
+	PCE.ROM_DATA = PCE.ROM + offset;
+	PCE.ROM_CRC = crc32_le(0, PCE.ROM, fsize);
+
+	return SetupCard(offset);
+}
+
+
+/**
+ * Leave the card on the storage and read its banks as they are mapped
+ */
+int
+LoadCardPaged(const char *name)
+{
+	uint8_t *buffer = malloc(0x2000);
+	uint32_t crc = 0;
+	int fsize, offset;
+
+	MESSAGE_INFO("Opening %s...\n", name);
+
+	FILE *fp = fopen(name, "rb");
+
+	if (fp == NULL || buffer == NULL)
+	{
+		MESSAGE_ERROR("Failed to open %s!\n", name);
+		if (fp) fclose(fp);
+		free(buffer);
+		return -1;
+	}
+
+	// The whole file goes through the crc, we need it to look the game up
+	for (size_t len; (len = fread(buffer, 1, 0x2000, fp)) > 0;)
+		crc = crc32_le(crc, buffer, len);
+
+	fsize = ftell(fp);
+	offset = fsize & 0x1fff;
+	fclose(fp);
+	free(buffer);
+
+	FreeCard();
+
+	PCE.ROM_PAGER = rg_pager_open(name, offset, fsize - offset, 0x2000, 8, 0);
+	PCE.ROM_SIZE = (fsize - offset) / 0x2000;
+	PCE.ROM_CRC = crc;
+
+	if (!PCE.ROM_PAGER)
+		return -1;
+
+	return SetupCard(offset);
+}
+
+
 /**
  * Reset the emulator
  */
@@ -325,22 +417,15 @@ RunPCE(void)
  * Load saved state
  */
 int
-LoadState(const char *name)
+LoadStateFP(FILE *fp)
 {
-	MESSAGE_INFO("Loading state from %s...\n", name);
-
 	char buffer[32];
 	block_hdr_t block;
-	int ret = -1;
-
-	FILE *fp = fopen(name, "rb");
-	if (fp == NULL)
-		return -1;
 
 	if (!fread(&buffer, 8, 1, fp) || memcmp(&buffer, SAVESTATE_HEADER, 8) != 0)
 	{
 		MESSAGE_ERROR("Loading state failed: Header mismatch\n");
-		goto _cleanup;
+		return -1;
 	}
 
 	while (fread(&block, sizeof(block), 1, fp))
@@ -356,13 +441,13 @@ LoadState(const char *name)
 				if (!fread(ptr, len, 1, fp))
 				{
 					MESSAGE_ERROR("fread error reading block data\n");
-					goto _cleanup;
+					return -1;
 				}
 				if (len < var->desc.len)
 				{
 					memset(ptr + len, 0, var->desc.len - len);
 				}
-				MESSAGE_INFO("Loaded %s\n", var->desc.key);
+				MESSAGE_DEBUG("Loaded %s\n", var->desc.key);
 				break;
 			}
 		}
@@ -374,12 +459,8 @@ LoadState(const char *name)
 
 	gfx_reset(true);
 	PCE.VDC.mode_chg = 1;
-	ret = 0;
-
-_cleanup:
-	fclose(fp);
 
-	return ret;
+	return 0;
 }
 
 
@@ -387,17 +468,13 @@ _cleanup:
  * Save current state
  */
 int
-SaveState(const char *name)
+SaveStateFP(FILE *fp)
 {
-	MESSAGE_INFO("Saving state to %s...\n", name);
-
-	int ret = -1;
-
-	FILE *fp = fopen(name, "wb");
-	if (fp == NULL)
+	if (!fwrite(SAVESTATE_HEADER, sizeof(SAVESTATE_HEADER), 1, fp))
+	{
+		MESSAGE_ERROR("fwrite error header\n");
 		return -1;
-
-	fwrite(SAVESTATE_HEADER, sizeof(SAVESTATE_HEADER), 1, fp);
+	}
 
 	for (save_var_t *var = SaveStateVars; var->ptr; var++)
 	{
@@ -406,25 +483,59 @@ SaveState(const char *name)
 		if (!fwrite(&var->desc, sizeof(var->desc), 1, fp))
 		{
 			MESSAGE_ERROR("fwrite error desc\n");
-			goto _cleanup;
+			return -1;
 		}
 		if (!fwrite(ptr, len, 1, fp))
 		{
 			MESSAGE_ERROR("fwrite error value\n");
-			goto _cleanup;
+			return -1;
 		}
-		MESSAGE_INFO("Saved %s\n", var->desc.key);
+		MESSAGE_DEBUG("Saved %s\n", var->desc.key);
 	}
 
-	ret = 0;
+	return 0;
+}
 
-_cleanup:
+
+/**
+ * Load saved state from a file
+ */
+int
+LoadState(const char *name)
+{
+	MESSAGE_INFO("Loading state from %s...\n", name);
+
+	FILE *fp = fopen(name, "rb");
+	if (fp == NULL)
+		return -1;
+
+	int ret = LoadStateFP(fp);
 	fclose(fp);
 
 	return ret;
 }
 
 
+/**
+ * Save current state to a file
+ */
+int
+SaveState(const char *name)
+{
+	MESSAGE_INFO("Saving state to %s...\n", name);
+
+	FILE *fp = fopen(name, "wb");
+	if (fp == NULL)
+		return -1;
+
+	int ret = SaveStateFP(fp);
+	if (fclose(fp) != 0)
+		ret = -1;
+
+	return ret;
+}
+
+
 /**
  * Cleanup and quit (not used in retro-go)
  */
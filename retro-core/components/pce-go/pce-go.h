@@ -72,11 +72,15 @@
 
 int LoadState(const char *name);
 int SaveState(const char *name);
+int LoadStateFP(FILE *fp);
+int SaveStateFP(FILE *fp);
 void ResetPCE(bool);
 void RunPCE(void);
 void ShutdownPCE();
 int InitPCE(int samplerate, bool stereo, const char *huecard);
 int LoadCard(const char *name);
+int LoadCardData(uint8_t *data, size_t size);
+int LoadCardPaged(const char *name);
 void *PalettePCE(int bitdepth);
 
 extern uint8_t *osd_gfx_framebuffer(int width, int height);
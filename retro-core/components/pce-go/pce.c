@@ -109,6 +109,8 @@ pce_term(void)
 	PCE.ExRAM = NULL;
 	free(PCE.ROM);
 	PCE.ROM = NULL;
+	rg_pager_close(PCE.ROM_PAGER);
+	PCE.ROM_PAGER = NULL;
 	free(PCE.NULLRAM);
 	PCE.NULLRAM = NULL;
 	free(PCE.MemoryMapR);
@@ -178,10 +180,9 @@ cart_write(uint16_t A, uint8_t V)
 		if (PCE.SF2 != (A & 3))
 		{
 			PCE.SF2 = A & 3;
-			uint8_t *base = PCE.ROM_DATA + PCE.SF2 * (512 * 1024);
 			for (int i = 0x40; i < 0x80; i++)
 			{
-				PCE.MemoryMapR[i] = base + i * 0x2000;
+				pce_rom_bank_set(i, PCE.SF2 * (512 * 1024) + i * 0x2000);
 			}
 			for (int i = 0; i < 8; i++)
 			{
@@ -142,6 +142,10 @@ typedef struct {
 	// ROM crc
 	uint32_t ROM_CRC;
 
+	// Large ROMs are paged in from the card as needed, MemoryMapR is NULL for their banks
+	rg_pager_t *ROM_PAGER;
+	uint32_t ROM_BANKS[0x80]; // Offset of each bank in the ROM
+
 	// For performance reasons we trap read/writes to unmapped areas:
 	uint8_t *IOAREA;
 	uint8_t *NULLRAM;
@@ -345,7 +349,19 @@ pce_bank_set(uint8_t P, uint8_t V)
 {
 	//TRACE_IO("Bank switching (MMR[%d] = %d)\n", P, V);
 
+	uint8_t *page = PCE.MemoryMapR[V];
+
+	if (page == NULL)
+		page = rg_pager_map(PCE.ROM_PAGER, P, PCE.ROM_BANKS[V]);
+
 	PCE.MMR[P] = V;
-	PageR[P] = (PCE.MemoryMapR[V] == PCE.IOAREA) ? (PCE.IOAREA) : (PCE.MemoryMapR[V] - P * 0x2000);
+	PageR[P] = (page == PCE.IOAREA) ? (PCE.IOAREA) : (page - P * 0x2000);
 	PageW[P] = (PCE.MemoryMapW[V] == PCE.IOAREA) ? (PCE.IOAREA) : (PCE.MemoryMapW[V] - P * 0x2000);
 }
+
+static inline void
+pce_rom_bank_set(uint8_t bank, uint32_t offset)
+{
+	PCE.ROM_BANKS[bank] = offset;
+	PCE.MemoryMapR[bank] = PCE.ROM_PAGER ? NULL : PCE.ROM_DATA + offset;
+}
@@ -250,12 +250,26 @@ static const rominfo_t game_list[GAME_DATABASE_CNT] =
 
 void set_rom_config(void)
 {
+  uint8 header[16] = {0};
+
   cart.pages = cart.size / 0x4000;
   cart.loaded = cart.rom != NULL;
 
+#ifdef RETRO_GO
+  if (cart.pager)
+  {
+    cart.loaded = 1;
+    if (cart.size > 0x7000)
+      rg_pager_read(cart.pager, 0x7ff0, header, sizeof(header));
+  }
+#endif
+
   if (!cart.loaded)
     return;
 
+  if (cart.rom && cart.size > 0x7000)
+    memcpy(header, &cart.rom[0x7ff0], sizeof(header));
+
   /* default sms settings */
   cart.mapper = MAPPER_SEGA;
   sms.console = CONSOLE_SMS2;
@@ -268,9 +282,9 @@ void set_rom_config(void)
 
   /* console type detection */
   /* SMS Header is located at 0x7ff0 */
-  if ((cart.size > 0x7000) && (!memcmp (&cart.rom[0x7ff0], "TMR SEGA", 8)))
+  if ((cart.size > 0x7000) && (!memcmp (&header[0], "TMR SEGA", 8)))
   {
-    uint8 region = (cart.rom[0x7fff] & 0xf0) >> 4;
+    uint8 region = (header[15] & 0xf0) >> 4;
 
     switch (region)
     {
@@ -364,9 +378,77 @@ void set_rom_config(void)
   }
 }
 
+/* Set up a cart from a ROM image already in memory, the cart takes ownership of `rom`.
+   The buffer must be at least 16KB, smaller images are expected to be zero padded. */
+int load_rom_data(uint8 *rom, size_t size)
+{
+  size_t actual_size = size;
+
+  cart.size = actual_size < 0x4000 ? 0x4000 : actual_size;
+  cart.rom = rom;
+  cart.sram = calloc(1, 0x8000);
+
+  if (!cart.rom || !cart.sram) abort();
+
+  /* Take care of image header, if present */
+  if ((cart.size / 512) & 1)
+  {
+    cart.size -= 512;
+    memmove(cart.rom, cart.rom + 512, cart.size);
+  }
+
+  cart.crc = crc32_le(0, cart.rom, option.console == 6 ? actual_size : cart.size);
+
+  set_rom_config();
+
+  MESSAGE_INFO("OK. cart.size=%d, cart.crc=%#010lx\n", (int)cart.size, cart.crc);
+
+  return 1;
+}
+
+#ifdef RETRO_GO
+/* Set up a cart that stays on the disk, the ROM is paged in as the mapper switches banks. */
+int load_rom_paged(const char *filename)
+{
+  FILE *fd = fopen(filename, "rb");
+  if (!fd)
+    return 0;
+
+  fseek(fd, 0, SEEK_END);
+  size_t actual_size = ftell(fd);
+  size_t offset = ((actual_size / 512) & 1) ? 512 : 0;
+
+  /* The checksum is streamed to keep memory usage flat */
+  uint8 *buffer = malloc(0x2000);
+  if (!buffer) abort();
+
+  cart.crc = 0;
+  fseek(fd, offset, SEEK_SET);
+  for (size_t len; (len = fread(buffer, 1, 0x2000, fd)) > 0;)
+    cart.crc = crc32_le(cart.crc, buffer, len);
+
+  free(buffer);
+  fclose(fd);
+
+  cart.size = actual_size - offset;
+  cart.rom = NULL;
+  cart.sram = calloc(1, 0x8000);
+  cart.pager = rg_pager_open(filename, offset, cart.size, 0x2000, 9, 0);
+
+  if (!cart.sram || !cart.pager) abort();
+
+  set_rom_config();
+
+  MESSAGE_INFO("OK. cart.size=%d, cart.crc=%#010lx (paged)\n", (int)cart.size, cart.crc);
+
+  return 1;
+}
+#endif
+
 int load_rom(const char *filename)
 {
   size_t actual_size = 0, count = 0;
+  uint8 *rom = NULL;
 
   FILE *fd = fopen(filename, "rb");
   if (fd)
@@ -375,18 +457,17 @@ int load_rom(const char *filename)
     actual_size = ftell(fd);
     fseek(fd, 0, SEEK_SET);
 
-    cart.size = actual_size < 0x4000 ? 0x4000 : actual_size;
-    cart.rom = calloc(1, cart.size);
-    cart.sram = calloc(1, 0x8000);
+    rom = calloc(1, actual_size < 0x4000 ? 0x4000 : actual_size);
 
-    if (!cart.rom || !cart.sram) abort();
+    if (!rom) abort();
 
-    count = fread(cart.rom, actual_size, 1, fd);
+    count = fread(rom, actual_size, 1, fd);
     fclose(fd);
   }
 
   if (count == 0)
   {
+    free(rom);
     return 0;
   }
 
@@ -395,18 +476,5 @@ int load_rom(const char *filename)
     option.console = 6;
   }
 
-  /* Take care of image header, if present */
-  if ((cart.size / 512) & 1)
-  {
-    cart.size -= 512;
-    memmove(cart.rom, cart.rom + 512, cart.size);
-  }
-
-  cart.crc = crc32_le(0, cart.rom, option.console == 6 ? actual_size : cart.size);
-
-  set_rom_config();
-
-  MESSAGE_INFO("OK. cart.size=%d, cart.crc=%#010lx\n", (int)cart.size, cart.crc);
-
-  return 1;
+  return load_rom_data(rom, actual_size);
 }
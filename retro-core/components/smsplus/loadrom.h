@@ -27,6 +27,10 @@
 
 /* Function prototypes */
 int load_rom(const char *filename);
+int load_rom_data(uint8 *rom, size_t size);
+#ifdef RETRO_GO
+int load_rom_paged(const char *filename);
+#endif
 void set_rom_config(void);
 
 #endif /* _LOADROM_H_ */
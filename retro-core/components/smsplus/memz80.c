@@ -41,8 +41,8 @@ void memctrl_w(uint8 data)
   /* detect CARTRIDGE/BIOS enabled/disabled */
   if (IS_SMS)
   {
-    /* autodetect loaded BIOS ROM */
-    if (!(bios.enabled & 2) && ((data & 0xE8) == 0xE8))
+    /* autodetect loaded BIOS ROM (not possible with a paged cartridge) */
+    if (!(bios.enabled & 2) && ((data & 0xE8) == 0xE8) && cart.rom)
     {
       bios.enabled = 0; //option.use_bios | 2;
       memcpy(bios.rom, cart.rom, cart.size);
@@ -54,6 +54,9 @@ void memctrl_w(uint8 data)
     /* disables CART & BIOS by default */
     slot.rom = NULL;
     slot.mapper = MAPPER_NONE;
+#ifdef RETRO_GO
+    slot.pager = NULL;
+#endif
 
     switch (data & 0x48)
     {
@@ -65,6 +68,9 @@ void memctrl_w(uint8 data)
           slot.pages  = cart.pages;
           slot.mapper = cart.mapper;
           slot.fcr    = &cart.fcr[0];
+#ifdef RETRO_GO
+          slot.pager  = cart.pager;
+#endif
         }
         break;
 
@@ -82,9 +88,13 @@ void memctrl_w(uint8 data)
     mapper_reset();
 
     /* reset SLOT mapping */
+#ifdef RETRO_GO
+    if (slot.rom || slot.pager)
+#else
     if (slot.rom)
+#endif
     {
-      cpu_readmap[0]  = &slot.rom[0];
+      cpu_readmap[0]  = slot_rom(0, 0);
       if (slot.mapper != MAPPER_KOREA_MSX)
       {
         mapper_16k_w(0,slot.fcr[0]);
@@ -198,6 +198,9 @@ void sms_reset(void)
   slot.pages    = cart.pages;
   slot.mapper   = cart.mapper;
   slot.fcr      = &cart.fcr[0];
+#ifdef RETRO_GO
+  slot.pager    = cart.pager;
+#endif
 
   /* reset Memory Mapping */
   switch(sms.console)
@@ -228,7 +231,7 @@ void sms_reset(void)
       /* $8000-$FFFF mapped to Cartridge ROM (max. 32K) */
       for(i = 0x20; i < 0x40; i++)
       {
-        cpu_readmap[i]  = &cart.rom[(i&0x1F) << 10];
+        cpu_readmap[i]  = slot_rom(i, (i&0x1F) << 10);
         cpu_writemap[i] = dummy_memory;
       }
 
@@ -249,7 +252,7 @@ void sms_reset(void)
       /* $0000-$7FFF mapped to cartridge ROM (max. 32K) */
       for(i = 0x00; i < 0x20; i++)
       {
-        cpu_readmap[i]  = &cart.rom[i << 10];
+        cpu_readmap[i]  = slot_rom(i, i << 10);
         cpu_writemap[i] = dummy_memory;
       }
 
@@ -288,6 +291,9 @@ void sms_reset(void)
           slot.pages  = bios.pages;
           slot.mapper = MAPPER_SEGA;
           slot.fcr    = &bios.fcr[0];
+#ifdef RETRO_GO
+          slot.pager  = NULL;
+#endif
           sms.memctrl = 0xE0;
         }
         else
@@ -300,7 +306,7 @@ void sms_reset(void)
       /* default cartridge ROM mapping at $0000-$BFFF (first 32k mirrored) */
       for(i = 0x00; i <= 0x2F; i++)
       {
-        cpu_readmap[i]  = &slot.rom[(i & 0x1F) << 10];
+        cpu_readmap[i]  = slot_rom(i, (i & 0x1F) << 10);
         cpu_writemap[i] = dummy_memory;
       }
 
@@ -369,7 +375,7 @@ void mapper_8k_w(int address, int data)
     {
       for(i = 0x20; i <= 0x27; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 13) | ((i & 0x07) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 13) | ((i & 0x07) << 10));
       }
       break;
     }
@@ -378,7 +384,7 @@ void mapper_8k_w(int address, int data)
     {
       for(i = 0x28; i <= 0x2F; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 13) | ((i & 0x07) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 13) | ((i & 0x07) << 10));
       }
       break;
     }
@@ -387,7 +393,7 @@ void mapper_8k_w(int address, int data)
     {
       for(i = 0x10; i <= 0x17; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 13) | ((i & 0x07) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 13) | ((i & 0x07) << 10));
       }
       break;
     }
@@ -396,7 +402,7 @@ void mapper_8k_w(int address, int data)
     {
       for(i = 0x18; i <= 0x1F; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 13) | ((i & 0x07) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 13) | ((i & 0x07) << 10));
       }
       break;
     }
@@ -446,7 +452,7 @@ void mapper_16k_w(int address, int data)
         /* cartridge ROM mapped at $8000-$BFFF */
         for(i = 0x20; i <= 0x2F; i++)
         {
-          cpu_readmap[i] = &slot.rom[(page << 14) | ((i & 0x0F) << 10)];
+          cpu_readmap[i] = slot_rom(i, (page << 14) | ((i & 0x0F) << 10));
           cpu_writemap[i] = dummy_memory;
         }
       }
@@ -476,12 +482,12 @@ void mapper_16k_w(int address, int data)
       /* first 1k is not fixed (CODEMASTER mapper) */
       if (slot.mapper == MAPPER_CODIES)
       {
-        cpu_readmap[0] = &slot.rom[(page << 14)];
+        cpu_readmap[0] = slot_rom(0, (page << 14));
       }
 
       for(i = 0x01; i <= 0x0F; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 14) | ((i & 0x0F) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 14) | ((i & 0x0F) << 10));
       }
       break;
     }
@@ -490,7 +496,7 @@ void mapper_16k_w(int address, int data)
     {
       for(i = 0x10; i <= 0x1F; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 14) | ((i & 0x0F) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 14) | ((i & 0x0F) << 10));
       }
 
       /* Ernie Elf's Golf external RAM switch */
@@ -510,7 +516,7 @@ void mapper_16k_w(int address, int data)
           /* cartridge ROM mapped at $A000-$BFFF */
           for(i = 0x28; i <= 0x2F; i++)
           {
-            cpu_readmap[i] = &slot.rom[((slot.fcr[3] % slot.pages) << 14) | ((i & 0x0F) << 10)];
+            cpu_readmap[i] = slot_rom(i, ((slot.fcr[3] % slot.pages) << 14) | ((i & 0x0F) << 10));
             cpu_writemap[i] = dummy_memory;
           }
         }
@@ -526,7 +532,7 @@ void mapper_16k_w(int address, int data)
       /* first 8k */
       for(i = 0x20; i <= 0x27; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 14) | ((i & 0x0F) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 14) | ((i & 0x0F) << 10));
       }
 
       /* check that external RAM (8k) is not mapped at $A000-$BFFF (CODEMASTER mapper) */
@@ -535,13 +541,24 @@ void mapper_16k_w(int address, int data)
       /* last 8k */
       for(i = 0x28; i <= 0x2F; i++)
       {
-        cpu_readmap[i] = &slot.rom[(page << 14) | ((i & 0x0F) << 10)];
+        cpu_readmap[i] = slot_rom(i, (page << 14) | ((i & 0x0F) << 10));
       }
       break;
     }
   }
 }
 
+/* Pointer to `offset` in the slot ROM for cpu_readmap[index], the cartridge may be paged in from the disk */
+uint8 *slot_rom(int index, uint32 offset)
+{
+#ifdef RETRO_GO
+  /* Each 8K window is a pager slot, except the first 1K which stays fixed on the SEGA mapper */
+  if (slot.pager)
+    return rg_pager_map(slot.pager, index ? 1 + (index >> 3) : 0, offset);
+#endif
+  return &slot.rom[offset];
+}
+
 int sms_irq_callback(int param)
 {
   return 0xFF;
@@ -141,6 +141,9 @@ typedef struct
   uint8 *fcr;
   uint8 pages;
   uint8 mapper;
+#ifdef RETRO_GO
+  rg_pager_t *pager; /* Set if the slot is a paged cartridge */
+#endif
 } slot_t;
 
 typedef struct {
@@ -166,5 +169,6 @@ extern void mapper_reset(void);
 extern void mapper_8k_w(int address, int data);
 extern void mapper_16k_w(int address, int data);
 extern int sms_irq_callback(int param);
+extern uint8 *slot_rom(int index, uint32 offset);
 
 #endif /* _SMS_H_ */
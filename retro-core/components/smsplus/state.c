@@ -292,10 +292,13 @@ void system_load_state(void *mem)
     slot.pages  = cart.pages;
     slot.mapper = cart.mapper;
     slot.fcr = &cart.fcr[0];
+#ifdef RETRO_GO
+    slot.pager = cart.pager;
+#endif
 
     /* Restore mapping */
     mapper_reset();
-    cpu_readmap[0]  = &slot.rom[0];
+    cpu_readmap[0]  = slot_rom(0, 0);
     if (slot.mapper != MAPPER_KOREA_MSX)
     {
       mapper_16k_w(0,slot.fcr[0]);
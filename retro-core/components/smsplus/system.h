@@ -72,6 +72,9 @@ typedef struct
   int8 mapper;
   uint8 *sram; // [0x8000];
   uint8 fcr[4];
+#ifdef RETRO_GO
+  rg_pager_t *pager; /* Set if the ROM is paged in from the disk (rom is NULL) */
+#endif
 } cart_t;
 
 /* Bitmap structure */
@@ -13,13 +13,9 @@
 static const char header[16] = "SNES9X_000000002";
 
 
-bool S9xSaveState(const char *filename)
+bool S9xSaveStateFP(FILE *fp)
 {
    size_t chunks = 0;
-   FILE *fp = NULL;
-
-   if (!(fp = fopen(filename, "wb")))
-      return false;
 
    chunks += fwrite(&header, sizeof(header), 1, fp);
    chunks += fwrite(&CPU, sizeof(CPU), 1, fp);
@@ -35,26 +31,21 @@ bool S9xSaveState(const char *filename)
    chunks += fwrite(IAPU.RAM, 0x10000, 1, fp);
    chunks += fwrite(&SoundData, sizeof(SoundData), 1, fp);
 
-   printf("Saved chunks = %d\n", chunks);
-
-   fclose(fp);
+   if (chunks != 13)
+      printf("Saved chunks = %d\n", chunks);
 
    return chunks == 13;
 }
 
-bool S9xLoadState(const char *filename)
+bool S9xLoadStateFP(FILE *fp)
 {
    uint8_t buffer[512];
    size_t chunks = 0;
-   FILE *fp = NULL;
-
-   if (!(fp = fopen(filename, "rb")))
-      return false;
 
    if (!fread(buffer, 16, 1, fp) || memcmp(header, buffer, sizeof(header)) != 0)
    {
       printf("Wrong header found\n");
-      goto fail;
+      return false;
    }
 
    // At this point we can't go back and a failure will corrupt the state anyway
@@ -75,7 +66,8 @@ bool S9xLoadState(const char *filename)
    chunks += fread(IAPU.RAM, 0x10000, 1, fp);
    chunks += fread(&SoundData, sizeof(SoundData), 1, fp);
 
-   printf("Loaded chunks = %d\n", chunks);
+   if (chunks != 12)
+      printf("Loaded chunks = %d\n", chunks);
 
    // Fixing up registers and pointers:
 
@@ -99,10 +91,30 @@ bool S9xLoadState(const char *filename)
    S9xFixCycles();
    S9xReschedule();
 
-   fclose(fp);
    return true;
+}
+
+bool S9xSaveState(const char *filename)
+{
+   FILE *fp = NULL;
+
+   if (!(fp = fopen(filename, "wb")))
+      return false;
+
+   bool success = S9xSaveStateFP(fp);
+
+   return (fclose(fp) == 0) && success;
+}
+
+bool S9xLoadState(const char *filename)
+{
+   FILE *fp = NULL;
+
+   if (!(fp = fopen(filename, "rb")))
+      return false;
+
+   bool success = S9xLoadStateFP(fp);
 
-fail:
    fclose(fp);
-   return false;
+   return success;
 }
@@ -2,6 +2,9 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 
 bool S9xSaveState(const char *filename);
 bool S9xLoadState(const char *filename);
+bool S9xSaveStateFP(FILE *fp);
+bool S9xLoadStateFP(FILE *fp);
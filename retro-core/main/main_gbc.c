@@ -4,10 +4,11 @@
 #include <gnuboy.h>
 
 static int skipFrames = 20; // The 20 is to hide startup flicker in some games
-static bool slowFrame = false;
 
 static int video_time;
 static int audio_time;
+static bool deferAudio;
+static size_t pendingAudio;
 
 static const char *sramFile;
 static int autoSaveSRAM = 0;
@@ -15,13 +16,14 @@ static int autoSaveSRAM_Timer = 0;
 static bool useSystemTime = true;
 static bool loadBIOSFile = false;
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 
 static const char *SETTING_SAVESRAM = "SaveSRAM";
 static const char *SETTING_PALETTE  = "Palette";
 static const char *SETTING_SYSTIME = "SysTime";
 static const char *SETTING_LOADBIOS = "LoadBIOS";
+static const char *SETTING_RUNAHEAD = "RunAhead";
 // --- MAIN
 
 
@@ -52,9 +54,9 @@ static bool save_state_handler(const char *filename)
     return gnuboy_save_state(filename) == 0;
 }
 
-static bool load_state_handler(const char *filename)
+static bool state_loaded(bool success)
 {
-    if (gnuboy_load_state(filename) != 0)
+    if (!success)
     {
         // If a state fails to load then we should behave as we do on boot
         // which is a hard reset and load sram if present
@@ -74,6 +76,28 @@ static bool load_state_handler(const char *filename)
     return true;
 }
 
+static bool load_state_handler(const char *filename)
+{
+    return state_loaded(gnuboy_load_state(filename) == 0);
+}
+
+static bool save_state_mem_handler(void *buffer, size_t *size)
+{
+    FILE *fp = rg_storage_open_mem(buffer, *size, "wb");
+    bool success = fp && gnuboy_save_state_fp(fp) == 0;
+    *size = rg_storage_close_mem(fp);
+    return success && *size > 0;
+}
+
+static bool load_state_mem_handler(const void *buffer, size_t size)
+{
+    FILE *fp = rg_storage_open_mem((void *)buffer, size, "rb");
+    bool success = fp && gnuboy_load_state_fp(fp) == 0;
+    rg_storage_close_mem(fp);
+    // Used by rewind and run-ahead, possibly every frame, so we only do the recovery part
+    return success || state_loaded(false);
+}
+
 static bool reset_handler(bool hard)
 {
     gnuboy_reset(hard);
@@ -144,6 +168,40 @@ static rg_gui_event_t sram_autosave_cb(rg_gui_option_t *option, rg_gui_event_t e
     return RG_DIALOG_VOID;
 }
 
+static rg_gui_event_t run_ahead_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    int frames = rg_emu_get_run_ahead();
+
+    if (event == RG_DIALOG_PREV) frames = frames > 0 ? frames - 1 : 2;
+    if (event == RG_DIALOG_NEXT) frames = frames < 2 ? frames + 1 : 0;
+
+    if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
+    {
+        rg_emu_set_run_ahead(frames);
+        rg_settings_set_number(NS_APP, SETTING_RUNAHEAD, frames);
+    }
+
+    if (frames == 0) strcpy(option->value, "Off     ");
+    else sprintf(option->value, "%d frame%s", frames, frames > 1 ? "s" : " ");
+
+    return RG_DIALOG_VOID;
+}
+
+static rg_gui_event_t bank_cache_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    gb_bank_counters_t stats = gnuboy_get_bank_counters();
+    int switches = stats.hits + stats.misses;
+
+    // Hit rate, banks in memory, longest stall
+    if (switches > 0)
+        sprintf(option->value, "%d%% %d/%d %dms", (int)(stats.hits * 100ull / switches), stats.loaded, stats.budget,
+                (int)(stats.maxReadTime / 1000));
+    else
+        sprintf(option->value, "%d/%d", stats.loaded, stats.budget);
+
+    return RG_DIALOG_VOID;
+}
+
 static rg_gui_event_t enable_bios_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
@@ -218,7 +276,6 @@ static rg_gui_event_t rtc_update_cb(rg_gui_option_t *option, rg_gui_event_t even
 static void video_callback(void *buffer)
 {
     int64_t startTime = rg_system_timer();
-    slowFrame = !rg_display_sync(false);
     rg_display_submit(currentUpdate, 0);
     video_time += rg_system_timer() - startTime;
 }
@@ -226,6 +283,12 @@ static void video_callback(void *buffer)
 
 static void audio_callback(void *buffer, size_t length)
 {
+    // With run-ahead the real frame's audio is held until the frames ahead have been shown
+    if (deferAudio)
+    {
+        pendingAudio = length;
+        return;
+    }
     int64_t startTime = rg_system_timer();
     rg_audio_submit(buffer, length >> 1);
     audio_time += rg_system_timer() - startTime;
@@ -239,12 +302,16 @@ void gbc_main(void)
         .reset = &reset_handler,
         .screenshot = &screenshot_handler,
         .event = &event_handler,
+        .saveStateMem = &save_state_mem_handler,
+        .loadStateMem = &load_state_mem_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "Palette      ", "-", RG_DIALOG_FLAG_NORMAL, &palette_update_cb},
         {0, "RTC config   ", "-", RG_DIALOG_FLAG_NORMAL, &rtc_update_cb},
         {0, "SRAM autosave", "-", RG_DIALOG_FLAG_NORMAL, &sram_autosave_cb},
         {0, "Enable BIOS  ", "-", RG_DIALOG_FLAG_NORMAL, &enable_bios_cb},
+        {0, "Run-ahead    ", "-", RG_DIALOG_FLAG_NORMAL, &run_ahead_cb},
+        {0, "ROM banks    ", "-", RG_DIALOG_FLAG_NORMAL, &bank_cache_cb},
         RG_DIALOG_END
     };
 
@@ -252,11 +319,15 @@ void gbc_main(void)
 
     updates[0] = rg_surface_create(GB_WIDTH, GB_HEIGHT, RG_PIXEL_565_BE, MEM_ANY);
     updates[1] = rg_surface_create(GB_WIDTH, GB_HEIGHT, RG_PIXEL_565_BE, MEM_ANY);
+    // A third buffer lets us start a frame while another is pending and one is being drawn
+    if (!app->lowMemoryMode)
+        updates[2] = rg_surface_create(GB_WIDTH, GB_HEIGHT, RG_PIXEL_565_BE, MEM_SLOW | MEM_NOPANIC);
     currentUpdate = updates[0];
 
     useSystemTime = (bool)rg_settings_get_number(NS_APP, SETTING_SYSTIME, 1);
     loadBIOSFile = (bool)rg_settings_get_number(NS_APP, SETTING_LOADBIOS, 0);
     autoSaveSRAM = (int)rg_settings_get_number(NS_APP, SETTING_SAVESRAM, 0);
+    rg_emu_set_run_ahead(rg_settings_get_number(NS_APP, SETTING_RUNAHEAD, 0));
     sramFile = rg_emu_get_path(RG_PATH_SAVE_SRAM, app->romPath);
 
     if (!rg_storage_mkdir(rg_dirname(sramFile)))
@@ -269,6 +340,12 @@ void gbc_main(void)
     gnuboy_set_framebuffer(currentUpdate->data);
     gnuboy_set_soundbuffer((void *)audioBuffer, sizeof(audioBuffer) / 2);
 
+    // Without PSRAM large ROMs don't fit, the bank cache has to leave room for the rest of the system
+    int bankBudget = 0;
+    if (app->lowMemoryMode)
+        bankBudget = RG_MAX(((int)rg_free_memory(MEM_FAST, NULL) - 64 * 1024) / 0x4000, 3);
+    gnuboy_set_bank_cache(bankBudget, true);
+
     // Load ROM
     if (gnuboy_load_rom(app->romPath) < 0)
         RG_PANIC("ROM Loading failed!");
@@ -337,10 +414,32 @@ void gbc_main(void)
 
         if (drawFrame)
         {
-            currentUpdate = updates[currentUpdate == updates[0]];
+            currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates));
             gnuboy_set_framebuffer(currentUpdate->data);
         }
-        gnuboy_run(drawFrame);
+
+        if (drawFrame && rg_emu_get_run_ahead() > 0)
+        {
+            // The real frame is only heard, the last frame ahead is only seen, then we roll back
+            deferAudio = true;
+            gnuboy_run(false);
+            deferAudio = false;
+            if (rg_emu_run_ahead_begin())
+            {
+                gnuboy_set_soundbuffer(NULL, 0);
+                for (int frames = rg_emu_get_run_ahead(); frames > 0; frames--)
+                    gnuboy_run(frames == 1);
+                gnuboy_set_soundbuffer((void *)audioBuffer, sizeof(audioBuffer) / 2);
+                rg_emu_run_ahead_end();
+            }
+            if (pendingAudio > 0)
+                audio_callback(audioBuffer, pendingAudio);
+            pendingAudio = 0;
+        }
+        else
+        {
+            gnuboy_run(drawFrame);
+        }
 
         if (autoSaveSRAM > 0)
         {
@@ -368,8 +467,6 @@ void gbc_main(void)
                 skipFrames = app->frameskip;
             else if (elapsed > frameTime + 1500) // Allow some jitter
                 skipFrames = 1; // (elapsed / frameTime)
-            else if (drawFrame && slowFrame)
-                skipFrames = 1;
         }
         else if (skipFrames > 0)
         {
@@ -88,6 +88,27 @@ static bool gw_system_LoadState(const char *pathName)
     return success;
 }
 
+static bool gw_system_SaveStateMem(void *buffer, size_t *size)
+{
+    if (*size < sizeof(gw_state_t))
+    {
+        *size = sizeof(gw_state_t);
+        return false;
+    }
+    gw_state_save((gw_state_t *)buffer);
+    *size = sizeof(gw_state_t);
+    return true;
+}
+
+static bool gw_system_LoadStateMem(const void *buffer, size_t size)
+{
+    if (size < sizeof(gw_state_t))
+        return false;
+    gw_state_t state_save_buffer;
+    memcpy(&state_save_buffer, buffer, sizeof(gw_state_t));
+    return gw_state_load(&state_save_buffer);
+}
+
 /* callback to get buttons state */
 unsigned int gw_get_buttons()
 {
@@ -133,6 +154,8 @@ void gw_main(void)
         .saveState = &gw_system_SaveState,
         .screenshot = &screenshot_handler,
         .event = &event_handler,
+        .saveStateMem = &gw_system_SaveStateMem,
+        .loadStateMem = &gw_system_LoadStateMem,
     };
     const rg_gui_option_t options[] = {
         RG_DIALOG_END,
@@ -14,76 +14,69 @@ static int dpad_mapped_down;
 static int dpad_mapped_left;
 static int dpad_mapped_right;
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 // static bool netplay = false;
 // --- MAIN
 
 static void set_display_mode(void)
 {
-    display_rotation_t rotation = rg_display_get_rotation();
-    int width, height;
+    display_rotation_t rotation = RG_DISPLAY_ROTATION_OFF;
 
-    if (rotation == RG_DISPLAY_ROTATION_AUTO)
+    switch (lynx->mCart->CRC32())
     {
-        rotation = RG_DISPLAY_ROTATION_OFF;
-
-        switch (lynx->mCart->CRC32())
-        {
-            case 0x97501709: // Centipede
-            case 0x0271B6E9: // Lexis
-            case 0x006FD398: // NFL Football
-            case 0xBCD10C3A: // Raiden
+        case 0x97501709: // Centipede
+        case 0x0271B6E9: // Lexis
+        case 0x006FD398: // NFL Football
+        case 0xBCD10C3A: // Raiden
+            rotation = RG_DISPLAY_ROTATION_LEFT;
+            break;
+        case 0x7F0EC7AD: // Gauntlet
+        case 0xAC564BAA: // Gauntlet - The Third Encounter
+        case 0xA53649F1: // Klax
+            rotation = RG_DISPLAY_ROTATION_RIGHT;
+            break;
+        default:
+            if (lynx->mCart->CartGetRotate() == CART_ROTATE_LEFT)
                 rotation = RG_DISPLAY_ROTATION_LEFT;
-                break;
-            case 0x7F0EC7AD: // Gauntlet
-            case 0xAC564BAA: // Gauntlet - The Third Encounter
-            case 0xA53649F1: // Klax
+            if (lynx->mCart->CartGetRotate() == CART_ROTATE_RIGHT)
                 rotation = RG_DISPLAY_ROTATION_RIGHT;
-                break;
-            default:
-                if (lynx->mCart->CartGetRotate() == CART_ROTATE_LEFT)
-                    rotation = RG_DISPLAY_ROTATION_LEFT;
-                if (lynx->mCart->CartGetRotate() == CART_ROTATE_RIGHT)
-                    rotation = RG_DISPLAY_ROTATION_RIGHT;
-        }
     }
 
+    // The display does the rotation, we only need to tell it what AUTO means for this cart
+    lynx->mMikie->SetRotation(MIKIE_NO_ROTATE);
+    rg_display_set_auto_rotation(rotation);
+
+    if (rg_display_get_rotation() != RG_DISPLAY_ROTATION_AUTO)
+        rotation = rg_display_get_rotation();
+
     switch(rotation)
     {
         case RG_DISPLAY_ROTATION_LEFT:
-            width = HANDY_SCREEN_HEIGHT;
-            height = HANDY_SCREEN_WIDTH;
-            lynx->mMikie->SetRotation(MIKIE_ROTATE_L);
             dpad_mapped_up    = BUTTON_RIGHT;
             dpad_mapped_down  = BUTTON_LEFT;
             dpad_mapped_left  = BUTTON_UP;
             dpad_mapped_right = BUTTON_DOWN;
             break;
         case RG_DISPLAY_ROTATION_RIGHT:
-            width = HANDY_SCREEN_HEIGHT;
-            height = HANDY_SCREEN_WIDTH;
-            lynx->mMikie->SetRotation(MIKIE_ROTATE_R);
             dpad_mapped_up    = BUTTON_LEFT;
             dpad_mapped_down  = BUTTON_RIGHT;
             dpad_mapped_left  = BUTTON_DOWN;
             dpad_mapped_right = BUTTON_UP;
             break;
+        case RG_DISPLAY_ROTATION_INVERT:
+            dpad_mapped_up    = BUTTON_DOWN;
+            dpad_mapped_down  = BUTTON_UP;
+            dpad_mapped_left  = BUTTON_RIGHT;
+            dpad_mapped_right = BUTTON_LEFT;
+            break;
         default:
-            width = HANDY_SCREEN_WIDTH;
-            height = HANDY_SCREEN_HEIGHT;
-            lynx->mMikie->SetRotation(MIKIE_NO_ROTATE);
             dpad_mapped_up    = BUTTON_UP;
             dpad_mapped_down  = BUTTON_DOWN;
             dpad_mapped_left  = BUTTON_LEFT;
             dpad_mapped_right = BUTTON_RIGHT;
             break;
     }
-
-    updates[0]->width = width;
-    updates[0]->height = height;
-    updates[1]->width = width;
-    updates[1]->height = height;
 }
 
 
@@ -108,6 +101,7 @@ static rg_gui_event_t rotation_cb(rg_gui_option_t *option, rg_gui_event_t event)
     if (rotation == RG_DISPLAY_ROTATION_AUTO)  strcpy(option->value, "Auto ");
     if (rotation == RG_DISPLAY_ROTATION_LEFT)  strcpy(option->value, "Left ");
     if (rotation == RG_DISPLAY_ROTATION_RIGHT) strcpy(option->value, "Right");
+    if (rotation == RG_DISPLAY_ROTATION_INVERT) strcpy(option->value, "Invert");
 
     return RG_DIALOG_VOID;
 }
@@ -155,11 +149,31 @@ static bool load_state_handler(const char *filename)
     return ret;
 }
 
+static bool save_state_mem_handler(void *buffer, size_t *size)
+{
+    FILE *fp = rg_storage_open_mem(buffer, *size, "wb");
+    bool ret = fp && lynx->ContextSave(fp);
+    *size = rg_storage_close_mem(fp);
+    return ret && *size > 0;
+}
+
+static bool load_state_mem_handler(const void *buffer, size_t size)
+{
+    FILE *fp = rg_storage_open_mem((void *)buffer, size, "rb");
+    bool ret = fp && lynx->ContextLoad(fp);
+    rg_storage_close_mem(fp);
+
+    if (!ret) lynx->Reset();
+
+    return ret;
+}
+
 static bool reset_handler(bool hard)
 {
     // This isn't nice but lynx->Reset() crashes...
     delete lynx;
     lynx = new CSystem(app->romPath, MIKIE_PIXEL_FORMAT_16BPP_565_BE, app->sampleRate);
+    set_display_mode();
     return true;
 }
 
@@ -173,6 +187,8 @@ extern "C" void lynx_main(void)
         .event = &event_handler,
         .memRead = NULL,
         .memWrite = NULL,
+        .saveStateMem = &save_state_mem_handler,
+        .loadStateMem = &load_state_mem_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "Rotation", (char *)"-", RG_DIALOG_FLAG_NORMAL, &rotation_cb},
@@ -181,9 +197,11 @@ extern "C" void lynx_main(void)
 
     app = rg_system_reinit(AUDIO_SAMPLE_RATE, &handlers, options);
 
-    // the HANDY_SCREEN_WIDTH * HANDY_SCREEN_WIDTH is deliberate because of rotation
-    updates[0] = rg_surface_create(HANDY_SCREEN_WIDTH, HANDY_SCREEN_WIDTH, RG_PIXEL_565_BE, MEM_FAST);
-    updates[1] = rg_surface_create(HANDY_SCREEN_WIDTH, HANDY_SCREEN_WIDTH, RG_PIXEL_565_BE, MEM_FAST);
+    updates[0] = rg_surface_create(HANDY_SCREEN_WIDTH, HANDY_SCREEN_HEIGHT, RG_PIXEL_565_BE, MEM_FAST);
+    updates[1] = rg_surface_create(HANDY_SCREEN_WIDTH, HANDY_SCREEN_HEIGHT, RG_PIXEL_565_BE, MEM_FAST);
+    // A third buffer lets us start a frame while another is pending and one is being drawn
+    if (!app->lowMemoryMode)
+        updates[2] = rg_surface_create(HANDY_SCREEN_WIDTH, HANDY_SCREEN_HEIGHT, RG_PIXEL_565_BE, MEM_SLOW | MEM_NOPANIC);
     currentUpdate = updates[0];
 
     // The Lynx has a variable framerate but 60 is typical
@@ -210,7 +228,6 @@ extern "C" void lynx_main(void)
 
     float sampleTime = 1000000.f / app->sampleRate;
     long skipFrames = 0;
-    bool slowFrame = false;
 
     // Start emulation
     while (1)
@@ -244,9 +261,8 @@ extern "C" void lynx_main(void)
 
         if (drawFrame)
         {
-            slowFrame = !rg_display_sync(false);
             rg_display_submit(currentUpdate, 0);
-            currentUpdate = updates[currentUpdate == updates[0]];
+            currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates));
             gPrimaryFrameBuffer = (UBYTE*)currentUpdate->data;
         }
 
@@ -265,8 +281,6 @@ extern "C" void lynx_main(void)
             // The Lynx uses a variable framerate so we use the count of generated audio samples as reference instead
             else if (elapsed > frameTime + 1500)
                 skipFrames = 1; // (elapsed / frameTime)
-            else if (drawFrame && slowFrame)
-                skipFrames = 1;
         }
         else if (skipFrames > 0)
         {
@@ -6,17 +6,17 @@
 static int overscan = true;
 static int autocrop = 0;
 static int palette = 0;
-static bool slowFrame = false;
 static bool nsfPlayer = false;
 static nes_t *nes;
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 
 static const char *SETTING_AUTOCROP = "autocrop";
 static const char *SETTING_OVERSCAN = "overscan";
 static const char *SETTING_PALETTE = "palette";
 static const char *SETTING_SPRITELIMIT = "spritelimit";
+static const char *SETTING_AUDIOSYNTH = "audiosynth";
 // --- MAIN
 
 
@@ -51,6 +51,24 @@ static bool load_state_handler(const char *filename)
     return true;
 }
 
+static bool save_state_mem_handler(void *buffer, size_t *size)
+{
+    FILE *fp = rg_storage_open_mem(buffer, *size, "wb");
+    bool success = fp && state_save_fp(fp) == 0;
+    *size = rg_storage_close_mem(fp);
+    return success && *size > 0;
+}
+
+static bool load_state_mem_handler(const void *buffer, size_t size)
+{
+    FILE *fp = rg_storage_open_mem((void *)buffer, size, "rb");
+    bool success = fp && state_load_fp(fp) == 0;
+    rg_storage_close_mem(fp);
+    if (!success)
+        nes_reset(true);
+    return success;
+}
+
 static bool reset_handler(bool hard)
 {
     nes_reset(hard);
@@ -65,6 +83,8 @@ static void build_palette(int n)
         uint16_t color = (pal[i] >> 8) | ((pal[i]) << 8);
         updates[0]->palette[i] = color;
         updates[1]->palette[i] = color;
+        if (updates[2])
+            updates[2]->palette[i] = color;
     }
     free(pal);
 }
@@ -85,6 +105,29 @@ static rg_gui_event_t sprite_limit_cb(rg_gui_option_t *option, rg_gui_event_t ev
     return RG_DIALOG_VOID;
 }
 
+static void update_apu_filter(void)
+{
+    // The APU's own filter is a low-pass too, running it before the shared one would muffle the sound twice
+    bool shared = rg_audio_get_filter() & RG_AUDIO_FILTER_LOWPASS;
+    apu_setopt(APU_FILTER_TYPE, shared ? APU_FILTER_NONE : APU_FILTER_WEIGHTED);
+}
+
+static rg_gui_event_t audio_synth_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    int synth = apu_getopt(APU_SYNTH_TYPE);
+
+    if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
+    {
+        synth = (synth == APU_SYNTH_BLEP) ? APU_SYNTH_NAIVE : APU_SYNTH_BLEP;
+        rg_settings_set_number(NS_APP, SETTING_AUDIOSYNTH, synth);
+        apu_setopt(APU_SYNTH_TYPE, synth);
+    }
+
+    strcpy(option->value, synth == APU_SYNTH_BLEP ? "Band-limited" : "Fast        ");
+
+    return RG_DIALOG_VOID;
+}
+
 static rg_gui_event_t overscan_update_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
@@ -150,7 +193,6 @@ static rg_gui_event_t palette_update_cb(rg_gui_option_t *option, rg_gui_event_t
 
 static void blit_screen(uint8 *bmp)
 {
-    slowFrame = bmp && !rg_display_sync(false);
     // A rolling average should be used for autocrop == 1, it causes jitter in some games...
     // int crop_h = (autocrop == 2) || (autocrop == 1 && nes->ppu->left_bg_counter > 210) ? 8 : 0;
     int crop_v = (overscan) ? nes->overscan : 0;
@@ -175,7 +217,10 @@ static void nsf_draw_overlay(void)
         RG_DIALOG_END,
     };
     snprintf(song, sizeof(song), "%d / %d", nsf_current_song, header->total_songs);
+    // Drawing the same dialog again doesn't cost anything, only changed pixels are sent
+    rg_gui_set_osd(true);
     rg_gui_draw_dialog("NSF Player", options, -1);
+    rg_gui_set_osd(false);
 }
 
 
@@ -187,12 +232,15 @@ void nes_main(void)
         .reset = &reset_handler,
         .event = &event_handler,
         .screenshot = &screenshot_handler,
+        .saveStateMem = &save_state_mem_handler,
+        .loadStateMem = &load_state_mem_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "Palette     ", "-", RG_DIALOG_FLAG_NORMAL, &palette_update_cb},
         {0, "Overscan    ", "-", RG_DIALOG_FLAG_NORMAL, &overscan_update_cb},
         {0, "Crop sides  ", "-", RG_DIALOG_FLAG_NORMAL, &autocrop_update_cb},
         {0, "Sprite limit", "-", RG_DIALOG_FLAG_NORMAL, &sprite_limit_cb},
+        {0, "Audio synth ", "-", RG_DIALOG_FLAG_NORMAL, &audio_synth_cb},
         RG_DIALOG_END
     };
 
@@ -204,6 +252,9 @@ void nes_main(void)
 
     updates[0] = rg_surface_create(NES_SCREEN_PITCH, NES_SCREEN_HEIGHT, RG_PIXEL_PAL565_BE, MEM_FAST);
     updates[1] = rg_surface_create(NES_SCREEN_PITCH, NES_SCREEN_HEIGHT, RG_PIXEL_PAL565_BE, MEM_FAST);
+    // A third buffer lets us start a frame while another is pending and one is being drawn
+    if (!app->lowMemoryMode)
+        updates[2] = rg_surface_create(NES_SCREEN_PITCH, NES_SCREEN_HEIGHT, RG_PIXEL_PAL565_BE, MEM_SLOW | MEM_NOPANIC);
     currentUpdate = updates[0];
 
     nes = nes_init(SYS_DETECT, app->sampleRate, true);
@@ -212,7 +263,26 @@ void nes_main(void)
         RG_PANIC("Init failed.");
     }
 
-    int ret = nes_insertcart(app->romPath, RG_BASE_PATH_BIOS "/fds_bios.bin");
+    // Carts that are too big for memory (or for nofrendo's 2MB limit) keep their PRG-ROM on the storage
+    rg_rom_file_t *rom = rg_storage_rom_open(app->romPath);
+    size_t rom_size = rg_storage_rom_size(rom);
+    bool paged = rom && !rg_storage_rom_compressed(rom) && (rom_size > 0x200000 || rg_pager_wanted(rom_size));
+    rg_storage_rom_close(rom);
+
+    int ret;
+    if (paged)
+    {
+        ret = nes_insertpaged(app->romPath);
+    }
+    else
+    {
+        void *data;
+        size_t size;
+        if (!rg_storage_rom_load(app->romPath, &data, &size))
+            RG_PANIC("ROM file loading failed!");
+        ret = nes_insertimage(data, size, app->romPath, RG_BASE_PATH_BIOS "/fds_bios.bin");
+    }
+
     if (ret == -1)
         RG_PANIC("ROM load failed.");
     else if (ret == -2)
@@ -228,6 +298,8 @@ void nes_main(void)
     nsfPlayer = nes->cart->mapper_number == 31;
 
     ppu_setopt(PPU_LIMIT_SPRITES, rg_settings_get_number(NS_APP, SETTING_SPRITELIMIT, 1));
+    apu_setopt(APU_SYNTH_TYPE, rg_settings_get_number(NS_APP, SETTING_AUDIOSYNTH, APU_SYNTH_NAIVE));
+    update_apu_filter();
 
     build_palette(palette);
 
@@ -253,6 +325,7 @@ void nes_main(void)
                 rg_gui_game_menu();
             else
                 rg_gui_options_menu();
+            update_apu_filter();
         }
 
         int64_t startTime = rg_system_timer();
@@ -270,7 +343,7 @@ void nes_main(void)
 
         if (drawFrame)
         {
-            currentUpdate = updates[currentUpdate == updates[0]];
+            currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates));
             nes_setvidbuf(currentUpdate->data);
         }
 
@@ -293,8 +366,6 @@ void nes_main(void)
                 skipFrames = app->frameskip;
             else if (elapsed > frameTime + 1500) // Allow some jitter
                 skipFrames = 1; // (elapsed / frameTime)
-            else if (drawFrame && slowFrame)
-                skipFrames = 1;
         }
         else if (skipFrames > 0)
         {
@@ -16,9 +16,8 @@ static bool emulationPaused = false; // This should probably be a mutex
 static int overscan = false;
 static int skipFrames = 0;
 static bool drawFrame = true;
-static bool slowFrame = false;
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 
 static const char *SETTING_OVERSCAN  = "overscan";
@@ -55,9 +54,8 @@ void osd_vsync(void)
 
     if (drawFrame)
     {
-        slowFrame = !rg_display_sync(false);
         rg_display_submit(currentUpdate, 0);
-        currentUpdate = updates[currentUpdate == updates[0]];
+        currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates));
     }
 
     // See if we need to skip a frame to keep up
@@ -65,8 +63,6 @@ void osd_vsync(void)
     {
         if (app->frameskip > 0)
             skipFrames = app->frameskip;
-        else if (drawFrame && slowFrame)
-            skipFrames = 1;
     }
     else if (skipFrames > 0)
     {
@@ -148,14 +144,14 @@ static void event_handler(int event, void *arg)
     if (event == RG_EVENT_REDRAW)
     {
         // We must use previous update because at this point current has been wiped.
-        rg_display_submit(updates[currentUpdate == updates[0]], 0);
+        rg_display_submit(rg_display_get_last_update() ?: currentUpdate, 0);
     }
 }
 
 static bool screenshot_handler(const char *filename, int width, int height)
 {
     // We must use previous update because at this point current has been wiped.
-    return rg_surface_save_image_file(updates[currentUpdate == updates[0]], filename, width, height);
+    return rg_surface_save_image_file(rg_display_get_last_update() ?: currentUpdate, filename, width, height);
 }
 
 static bool save_state_handler(const char *filename)
@@ -173,6 +169,24 @@ static bool load_state_handler(const char *filename)
     return true;
 }
 
+static bool save_state_mem_handler(void *buffer, size_t *size)
+{
+    FILE *fp = rg_storage_open_mem(buffer, *size, "wb");
+    bool success = fp && SaveStateFP(fp) == 0;
+    *size = rg_storage_close_mem(fp);
+    return success && *size > 0;
+}
+
+static bool load_state_mem_handler(const void *buffer, size_t size)
+{
+    FILE *fp = rg_storage_open_mem((void *)buffer, size, "rb");
+    bool success = fp && LoadStateFP(fp) == 0;
+    rg_storage_close_mem(fp);
+    if (!success)
+        ResetPCE(false);
+    return success;
+}
+
 static bool reset_handler(bool hard)
 {
     ResetPCE(hard);
@@ -187,6 +201,8 @@ void pce_main(void)
         .reset = &reset_handler,
         .screenshot = &screenshot_handler,
         .event = &event_handler,
+        .saveStateMem = &save_state_mem_handler,
+        .loadStateMem = &load_state_mem_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "Overscan", "-", RG_DIALOG_FLAG_NORMAL, &overscan_update_cb},
@@ -198,26 +214,42 @@ void pce_main(void)
 
     updates[0] = rg_surface_create(XBUF_WIDTH, XBUF_HEIGHT, RG_PIXEL_PAL565_BE, MEM_FAST);
     updates[1] = rg_surface_create(XBUF_WIDTH, XBUF_HEIGHT, RG_PIXEL_PAL565_BE, MEM_FAST);
+    // A third buffer lets us start a frame while another is pending and one is being drawn
+    if (!app->lowMemoryMode)
+        updates[2] = rg_surface_create(XBUF_WIDTH, XBUF_HEIGHT, RG_PIXEL_PAL565_BE, MEM_SLOW | MEM_NOPANIC);
     currentUpdate = updates[0];
 
-    updates[0]->data += 16;
-    updates[0]->width -= 16;
-    updates[1]->data += 16;
-    updates[1]->width -= 16;
-
     uint16_t *palette = PalettePCE(16);
-    for (int i = 0; i < 256; i++)
+    for (size_t i = 0; i < RG_COUNT(updates) && updates[i]; ++i)
     {
-        uint16_t color = (palette[i] << 8) | (palette[i] >> 8);
-        updates[0]->palette[i] = color;
-        updates[1]->palette[i] = color;
+        updates[i]->data += 16;
+        updates[i]->width -= 16;
+        for (int j = 0; j < 256; j++)
+            updates[i]->palette[j] = (palette[j] << 8) | (palette[j] >> 8);
     }
     free(palette);
 
     emulationPaused = true;
     rg_task_create("pce_sound", &audioTask, NULL, 2 * 1024, RG_TASK_PRIORITY_2, 1);
 
-    InitPCE(app->sampleRate, true, app->romPath);
+    InitPCE(app->sampleRate, true, NULL);
+
+    // ROMs that don't fit in memory stay on the storage and are paged in as needed
+    rg_rom_file_t *rom = rg_storage_rom_open(app->romPath);
+    bool paged = rom && !rg_storage_rom_compressed(rom) && rg_pager_wanted(rg_storage_rom_size(rom));
+    rg_storage_rom_close(rom);
+
+    void *data;
+    size_t size;
+    if (paged)
+    {
+        if (LoadCardPaged(app->romPath))
+            RG_PANIC("ROM file loading failed!");
+    }
+    else if (!rg_storage_rom_load(app->romPath, &data, &size) || LoadCardData(data, size))
+        RG_PANIC("ROM file loading failed!");
+
+    ResetPCE(false);
 
     if (app->bootFlags & RG_BOOT_RESUME)
     {
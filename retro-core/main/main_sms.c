@@ -2,7 +2,7 @@
 
 #include <smsplus.h>
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 
 const rg_keyboard_map_t coleco_keyboard = {
@@ -20,6 +20,16 @@ static const char *SETTING_PALETTE = "palette";
 // --- MAIN
 
 
+// Palette changes are only reported once, the other buffers must get them too
+static void sync_palettes(void)
+{
+    for (size_t i = 0; i < RG_COUNT(updates) && updates[i]; ++i)
+    {
+        if (updates[i] != currentUpdate)
+            memcpy(updates[i]->palette, currentUpdate->palette, 512);
+    }
+}
+
 static void event_handler(int event, void *arg)
 {
     if (event == RG_EVENT_REDRAW)
@@ -58,6 +68,24 @@ static bool load_state_handler(const char *filename)
     return false;
 }
 
+static bool save_state_mem_handler(void *buffer, size_t *size)
+{
+    FILE *fp = rg_storage_open_mem(buffer, *size, "wb");
+    if (fp)
+        system_save_state(fp);
+    *size = rg_storage_close_mem(fp);
+    return *size > 0;
+}
+
+static bool load_state_mem_handler(const void *buffer, size_t size)
+{
+    FILE *fp = rg_storage_open_mem((void *)buffer, size, "rb");
+    if (fp)
+        system_load_state(fp);
+    rg_storage_close_mem(fp);
+    return fp != NULL;
+}
+
 static bool reset_handler(bool hard)
 {
     system_reset();
@@ -82,7 +110,7 @@ static rg_gui_event_t palette_update_cb(rg_gui_option_t *opt, rg_gui_event_t eve
             for (int i = 0; i < PALETTE_SIZE; i++)
                 palette_sync(i);
             if (render_copy_palette(currentUpdate->palette))
-                memcpy(updates[currentUpdate == updates[0]]->palette, currentUpdate->palette, 512);
+                sync_palettes();
             rg_settings_set_number(NS_APP, SETTING_PALETTE, pal);
         }
         return RG_DIALOG_REDRAW;
@@ -100,6 +128,8 @@ void sms_main(void)
         .reset = &reset_handler,
         .screenshot = &screenshot_handler,
         .event = &event_handler,
+        .saveStateMem = &save_state_mem_handler,
+        .loadStateMem = &load_state_mem_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "Palette ", "-", RG_DIALOG_FLAG_NORMAL, &palette_update_cb},
@@ -110,6 +140,9 @@ void sms_main(void)
 
     updates[0] = rg_surface_create(SMS_WIDTH, SMS_HEIGHT, RG_PIXEL_PAL565_BE, MEM_FAST);
     updates[1] = rg_surface_create(SMS_WIDTH, SMS_HEIGHT, RG_PIXEL_PAL565_BE, MEM_FAST);
+    // A third buffer lets us start a frame while another is pending and one is being drawn
+    if (!app->lowMemoryMode)
+        updates[2] = rg_surface_create(SMS_WIDTH, SMS_HEIGHT, RG_PIXEL_PAL565_BE, MEM_SLOW | MEM_NOPANIC);
     currentUpdate = updates[0];
 
     system_reset_config();
@@ -125,8 +158,26 @@ void sms_main(void)
     else
         option.console = 0;
 
-    if (!load_rom(app->romPath))
-        RG_PANIC("ROM file loading failed!");
+    // smsplus wants at least 16KB of (zero padded) ROM
+    rg_rom_file_t *rom = rg_storage_rom_open(app->romPath);
+    size_t rom_size = rg_storage_rom_size(rom);
+
+    // ROMs that don't fit in memory stay on the storage and are paged in as needed
+    if (rom && !rg_storage_rom_compressed(rom) && rg_pager_wanted(rom_size))
+    {
+        rg_storage_rom_close(rom);
+        if (!load_rom_paged(app->romPath))
+            RG_PANIC("ROM file loading failed!");
+    }
+    else
+    {
+        void *rom_data = rom ? rg_alloc(RG_MAX(rom_size, 0x4000), MEM_SLOW | MEM_NOPANIC) : NULL;
+        bool loaded = rom_data && rg_storage_rom_read(rom, rom_data, rom_size);
+        rg_storage_rom_close(rom);
+
+        if (!loaded || !load_rom_data(rom_data, rom_size))
+            RG_PANIC("ROM file loading failed!");
+    }
 
     bitmap.width = SMS_WIDTH;
     bitmap.height = SMS_HEIGHT;
@@ -137,12 +188,12 @@ void sms_main(void)
 
     app->tickRate = (sms.display == DISPLAY_NTSC) ? FPS_NTSC : FPS_PAL;
 
-    updates[0]->offset = bitmap.viewport.x;
-    updates[0]->width = bitmap.viewport.w;
-    updates[0]->height = bitmap.viewport.h;
-    updates[1]->offset = bitmap.viewport.x;
-    updates[1]->width = bitmap.viewport.w;
-    updates[1]->height = bitmap.viewport.h;
+    for (size_t i = 0; i < RG_COUNT(updates) && updates[i]; ++i)
+    {
+        updates[i]->offset = bitmap.viewport.x;
+        updates[i]->width = bitmap.viewport.w;
+        updates[i]->height = bitmap.viewport.h;
+    }
 
     if (app->bootFlags & RG_BOOT_RESUME)
     {
@@ -167,7 +218,6 @@ void sms_main(void)
 
         int64_t startTime = rg_system_timer();
         bool drawFrame = !skipFrames;
-        bool slowFrame = false;
 
         input.pad[0] = 0x00;
         input.pad[1] = 0x00;
@@ -230,10 +280,9 @@ void sms_main(void)
         if (drawFrame)
         {
             if (render_copy_palette(currentUpdate->palette))
-                memcpy(updates[currentUpdate == updates[0]]->palette, currentUpdate->palette, 512);
-            slowFrame = !rg_display_sync(false);
+                sync_palettes();
             rg_display_submit(currentUpdate, 0);
-            currentUpdate = updates[currentUpdate == updates[0]]; // Swap
+            currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates)); // Swap
             bitmap.data = currentUpdate->data;
         }
 
@@ -261,8 +310,6 @@ void sms_main(void)
                 skipFrames = app->frameskip;
             else if (elapsed > frameTime + 1500) // Allow some jitter
                 skipFrames = 1; // (elapsed / frameTime)
-            else if (drawFrame && slowFrame)
-                skipFrames = 1;
         }
         else if (skipFrames > 0)
         {
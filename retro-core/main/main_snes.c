@@ -20,7 +20,7 @@
 
 #define AUDIO_LOW_PASS_RANGE ((60 * 65536) / 100)
 
-static rg_surface_t *updates[2];
+static rg_surface_t *updates[3];
 static rg_surface_t *currentUpdate;
 
 static bool apu_enabled = true;
@@ -41,7 +41,7 @@ static void update_keymap(int id)
 
 static bool screenshot_handler(const char *filename, int width, int height)
 {
-    return rg_surface_save_image_file(currentUpdate, filename, width, height);
+    return rg_surface_save_image_file(rg_display_get_last_update() ?: currentUpdate, filename, width, height);
 }
 
 static bool save_state_handler(const char *filename)
@@ -54,6 +54,22 @@ static bool load_state_handler(const char *filename)
     return S9xLoadState(filename);
 }
 
+static bool save_state_mem_handler(void *buffer, size_t *size)
+{
+    FILE *fp = rg_storage_open_mem(buffer, *size, "wb");
+    bool success = fp && S9xSaveStateFP(fp);
+    *size = rg_storage_close_mem(fp);
+    return success && *size > 0;
+}
+
+static bool load_state_mem_handler(const void *buffer, size_t size)
+{
+    FILE *fp = rg_storage_open_mem((void *)buffer, size, "rb");
+    bool success = fp && S9xLoadStateFP(fp);
+    rg_storage_close_mem(fp);
+    return success;
+}
+
 static bool reset_handler(bool hard)
 {
     S9xReset();
@@ -64,7 +80,7 @@ static void event_handler(int event, void *arg)
 {
     if (event == RG_EVENT_REDRAW)
     {
-        rg_display_submit(currentUpdate, 0);
+        rg_display_submit(rg_display_get_last_update() ?: currentUpdate, 0);
     }
 }
 
@@ -244,6 +260,8 @@ void snes_main(void)
         .reset = &reset_handler,
         .screenshot = &screenshot_handler,
         .event = &event_handler,
+        .saveStateMem = &save_state_mem_handler,
+        .loadStateMem = &load_state_mem_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "Audio enable", "-", RG_DIALOG_FLAG_NORMAL, &apu_toggle_cb},
@@ -255,8 +273,13 @@ void snes_main(void)
 
     apu_enabled = rg_settings_get_number(NS_APP, SETTING_APU_EMULATION, 1);
 
-    updates[0] = rg_surface_create(SNES_WIDTH, SNES_HEIGHT_EXTENDED, RG_PIXEL_565_LE, 0);
-    updates[0]->height = SNES_HEIGHT;
+    // Without a second buffer we fall back to skipping frames while the display is busy
+    for (size_t i = 0; i < RG_COUNT(updates); ++i)
+    {
+        if (!(updates[i] = rg_surface_create(SNES_WIDTH, SNES_HEIGHT_EXTENDED, RG_PIXEL_565_LE, 0)))
+            break;
+        updates[i]->height = SNES_HEIGHT;
+    }
     currentUpdate = updates[0];
 
     update_keymap(rg_settings_get_number(NS_APP, SETTING_KEYMAP, 0));
@@ -346,12 +369,21 @@ void snes_main(void)
 
         if (drawFrame)
         {
-            slowFrame = !rg_display_sync(false);
-            rg_display_submit(currentUpdate, 0);
+            if (updates[1])
+            {
+                rg_display_submit(currentUpdate, 0);
+                currentUpdate = rg_display_get_free_surface(updates, RG_COUNT(updates));
+            }
+            else
+            {
+                slowFrame = !rg_display_sync(false);
+                rg_display_submit(currentUpdate, 0);
+            }
         }
 
     #ifndef USE_BLARGG_APU
-        if (apu_enabled && lowpass_filter)
+        // The shared low-pass stage (rg_audio's filter presets) supersedes ours, no need to filter twice
+        if (apu_enabled && lowpass_filter && !(rg_audio_get_filter() & RG_AUDIO_FILTER_LOWPASS))
             S9xMixSamplesLowPass((void *)audioBuffer, AUDIO_BUFFER_LENGTH << 1, AUDIO_LOW_PASS_RANGE);
         else if (apu_enabled)
             S9xMixSamples((void *)audioBuffer, AUDIO_BUFFER_LENGTH << 1);